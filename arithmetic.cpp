@@ -0,0 +1,128 @@
+#include "arithmetic.h"
+#include "object.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+bool IsInteger(ObjectKind kind) {
+  return kind == ObjectKind::Number || kind == ObjectKind::BigNumber;
+}
+
+// Returns false if the result does not fit into 64 bits.
+bool ApplySmall(ArithmeticOp op, int64_t lhs, int64_t rhs, int64_t& result) {
+  switch (op) {
+    case ArithmeticOp::Add:
+      return !__builtin_add_overflow(lhs, rhs, &result);
+    case ArithmeticOp::Sub:
+      return !__builtin_sub_overflow(lhs, rhs, &result);
+    case ArithmeticOp::Mult:
+      return !__builtin_mul_overflow(lhs, rhs, &result);
+    case ArithmeticOp::Div:
+      if (rhs == 0) {
+        throw runtime_error("division by zero");
+      }
+      if (lhs == INT64_MIN && rhs == -1) {
+        return false;
+      }
+      result = lhs / rhs;
+      return true;
+  }
+  return false;
+}
+
+bool IsNumeric(ObjectKind kind) {
+  return IsInteger(kind) || kind == ObjectKind::Float;
+}
+
+double ApplyFloat(ArithmeticOp op, double lhs, double rhs) {
+  switch (op) {
+    case ArithmeticOp::Add: return lhs + rhs;
+    case ArithmeticOp::Sub: return lhs - rhs;
+    case ArithmeticOp::Mult: return lhs * rhs;
+    case ArithmeticOp::Div:
+      if (rhs == 0) {
+        throw runtime_error("division by zero");
+      }
+      return lhs / rhs;
+  }
+  return 0;
+}
+
+// An operand of the result's type that nobody else refers to is a dead
+// temporary (e.g. the a * b in a * b + c or in c + a * b), so its storage is
+// reused for the result instead of allocating a new object. So is one held
+// only by the variable the result replaces.
+template <typename T>
+ObjectHolder Store(T value, const ObjectHolder& lhs, const ObjectHolder& rhs, const ObjectHolder* destination) {
+  for (const ObjectHolder* operand : {&lhs, &rhs}) {
+    const bool dead = operand->IsUnique() || (destination && operand->IsSharedOnlyWith(*destination));
+    if (dead && KindOf(*operand) == ValueKind<T>()) {
+      ObjectHolder result = *operand;
+      static_cast<ValueObject<T>&>(*result).value = value;
+      return result;
+    }
+  }
+  return ObjectHolder::Own(ValueObject<T>(value));
+}
+
+BigInt ApplyBig(ArithmeticOp op, const BigInt& lhs, const BigInt& rhs) {
+  switch (op) {
+    case ArithmeticOp::Add: return lhs + rhs;
+    case ArithmeticOp::Sub: return lhs - rhs;
+    case ArithmeticOp::Mult: return lhs * rhs;
+    case ArithmeticOp::Div: return lhs / rhs;
+  }
+  return {};
+}
+
+}
+
+optional<ObjectHolder> Arithmetic(ArithmeticOp op, const ObjectHolder& lhs, const ObjectHolder& rhs, const ObjectHolder* destination) {
+  const ObjectKind lhs_kind = KindOf(lhs);
+  const ObjectKind rhs_kind = KindOf(rhs);
+
+  if (lhs_kind == ObjectKind::Number && rhs_kind == ObjectKind::Number) {
+    int64_t result;
+    if (ApplySmall(op, static_cast<const Number&>(*lhs).GetValue(), static_cast<const Number&>(*rhs).GetValue(), result)) {
+      return Store(result, lhs, rhs, destination);
+    }
+  } else if (!IsNumeric(lhs_kind) || !IsNumeric(rhs_kind)) {
+    return nullopt;
+  } else if (lhs_kind == ObjectKind::Float || rhs_kind == ObjectKind::Float) {
+    return Store(ApplyFloat(op, ToDouble(*lhs), ToDouble(*rhs)), lhs, rhs, destination);
+  }
+
+  return MakeInteger(ApplyBig(op, ToBigInt(*lhs), ToBigInt(*rhs)));
+}
+
+ObjectHolder MakeInteger(const BigInt& value) {
+  if (auto small = value.ToInt64()) {
+    return ObjectHolder::Own(Number(*small));
+  }
+  return ObjectHolder::Own(BigNumber(value));
+}
+
+BigInt ToBigInt(const Object& integer) {
+  if (integer.Kind() == ObjectKind::Number) {
+    return BigInt(static_cast<const Number&>(integer).GetValue());
+  }
+  return static_cast<const BigNumber&>(integer).GetValue();
+}
+
+double ToDouble(const Object& number) {
+  switch (number.Kind()) {
+    case ObjectKind::Number:
+      return static_cast<double>(static_cast<const Number&>(number).GetValue());
+    case ObjectKind::BigNumber:
+      return static_cast<const BigNumber&>(number).GetValue().ToDouble();
+    default:
+      return static_cast<const Float&>(number).GetValue();
+  }
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "object_holder.h"
+#include "bigint.h"
+
+#include <optional>
+
+namespace Runtime {
+
+enum class ArithmeticOp {
+  Add,
+  Sub,
+  Mult,
+  Div
+};
+
+// Numeric part of the arithmetic operators. Returns nullopt when either
+// operand is not a number, so the caller can try other meanings of the op.
+// The result goes into an operand that is a dead temporary when there is
+// one. destination is the variable the result is about to be assigned to:
+// an operand that only it holds besides is dead as well, as in
+// total = total + i.
+std::optional<ObjectHolder> Arithmetic(
+  ArithmeticOp op, const ObjectHolder& lhs, const ObjectHolder& rhs, const ObjectHolder* destination = nullptr
+);
+
+// Narrows to a 64-bit Number whenever the value fits.
+ObjectHolder MakeInteger(const BigInt& value);
+
+// Widens a Number or BigNumber object.
+BigInt ToBigInt(const Object& integer);
+
+// Converts any numeric object to double.
+double ToDouble(const Object& number);
+
+} /* namespace Runtime */
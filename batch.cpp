@@ -0,0 +1,187 @@
+#include "batch.h"
+#include "interpreter.h"
+#include "program.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct CompiledScript {
+  shared_ptr<const Program> program;
+  string error;
+};
+
+CompiledScript Compile(const string& path, const ProgramCache* cache) {
+  ifstream source(path);
+  if (!source) {
+    return {nullptr, "cannot open script " + path};
+  }
+  try {
+    if (cache) {
+      const string text{istreambuf_iterator<char>(source), istreambuf_iterator<char>()};
+      return {cache->Compile(text), ""};
+    }
+    return {Program::Compile(source), ""};
+  } catch (const exception& e) {
+    return {nullptr, "cannot parse " + path + ": " + e.what()};
+  }
+}
+
+// Closed after the sink writing into it has been destroyed
+struct FileDescriptor {
+  int fd;
+
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+  ~FileDescriptor() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+void Execute(const BatchTask& task, const CompiledScript& script, Limits limits, BatchResult& result) {
+  const auto start = Clock::now();
+  try {
+    if (!script.program) {
+      throw runtime_error(script.error);
+    }
+    ifstream input;
+    if (task.input != "-") {
+      input.open(task.input);
+      if (!input) {
+        throw runtime_error("cannot open input " + task.input);
+      }
+    }
+    FileDescriptor output{open(task.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+    if (output.fd < 0) {
+      throw runtime_error("cannot open output " + task.output);
+    }
+
+    FdSink sink(output.fd, FlushPolicy::OnSize);
+    Interpreter interpreter(sink, limits);
+    if (input.is_open()) {
+      interpreter.SetInput(input);
+    }
+    try {
+      interpreter.Run(script.program);
+    } catch (...) {
+      result.peak_memory = interpreter.Memory().Peak();
+      throw;
+    }
+    result.peak_memory = interpreter.Memory().Peak();
+    result.ok = true;
+  } catch (const exception& e) {
+    result.error = task.script + ": " + e.what();
+  }
+  result.latency = Clock::now() - start;
+}
+
+chrono::nanoseconds Percentile(const vector<chrono::nanoseconds>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return chrono::nanoseconds{0};
+  }
+  const size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[rank];
+}
+
+double Milliseconds(chrono::nanoseconds duration) {
+  return chrono::duration<double, milli>(duration).count();
+}
+
+}
+
+double BatchReport::Throughput() const {
+  const double seconds = chrono::duration<double>(total).count();
+  return seconds > 0 ? results.size() / seconds : 0.0;
+}
+
+vector<BatchTask> ReadManifest(istream& manifest) {
+  vector<BatchTask> tasks;
+  string line;
+  for (size_t number = 1; getline(manifest, line); ++number) {
+    istringstream fields(line);
+    BatchTask task;
+    if (!(fields >> task.script) || task.script[0] == '#') {
+      continue;
+    }
+    string extra;
+    if (!(fields >> task.input >> task.output) || fields >> extra) {
+      throw invalid_argument("manifest line " + to_string(number) + ": expected \"script input output\"");
+    }
+    tasks.push_back(std::move(task));
+  }
+  return tasks;
+}
+
+BatchReport RunBatch(const vector<BatchTask>& tasks, size_t thread_count, Limits limits, const ProgramCache* cache) {
+  BatchReport report;
+  report.results.resize(tasks.size());
+  const auto start = Clock::now();
+
+  unordered_map<string, CompiledScript> scripts;
+  for (const BatchTask& task : tasks) {
+    if (!scripts.count(task.script)) {
+      scripts.emplace(task.script, Compile(task.script, cache));
+    }
+  }
+
+  {
+    ThreadPool pool(thread_count);
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      pool.Submit([&task = tasks[i], &script = scripts.at(tasks[i].script), limits, &result = report.results[i]] {
+        Execute(task, script, limits, result);
+      });
+    }
+    pool.Wait();
+  }
+  report.total = Clock::now() - start;
+
+  vector<chrono::nanoseconds> latencies;
+  latencies.reserve(tasks.size());
+  for (const BatchResult& result : report.results) {
+    latencies.push_back(result.latency);
+    report.failed += !result.ok;
+    report.peak_memory = max(report.peak_memory, result.peak_memory);
+  }
+  sort(latencies.begin(), latencies.end());
+  report.p50 = Percentile(latencies, 0.50);
+  report.p90 = Percentile(latencies, 0.90);
+  report.p99 = Percentile(latencies, 0.99);
+  report.max = latencies.empty() ? chrono::nanoseconds{0} : latencies.back();
+  return report;
+}
+
+void PrintBatchReport(const BatchReport& report, ostream& os) {
+  for (const BatchResult& result : report.results) {
+    if (!result.ok) {
+      os << "failed: " << result.error << '\n';
+    }
+  }
+  os << "scripts: " << report.results.size() << ", failed: " << report.failed
+     << ", total: " << Milliseconds(report.total) << " ms"
+     << ", throughput: " << report.Throughput() << " scripts/s\n"
+     << "latency ms: p50 " << Milliseconds(report.p50) << ", p90 " << Milliseconds(report.p90)
+     << ", p99 " << Milliseconds(report.p99) << ", max " << Milliseconds(report.max) << '\n'
+     << "peak memory: " << report.peak_memory << " bytes\n";
+}
+
+} /* namespace Runtime */
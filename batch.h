@@ -0,0 +1,57 @@
+#pragma once
+
+#include "interpreter.h"
+#include "program_cache.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// One script run: the input() lines come from input ("-" for none) and the
+// printed output goes to the output file
+struct BatchTask {
+  std::string script;
+  std::string input;
+  std::string output;
+};
+
+struct BatchResult {
+  bool ok = false;
+  std::string error;
+  std::chrono::nanoseconds latency{0};
+  size_t peak_memory = 0;  // bytes
+};
+
+struct BatchReport {
+  std::vector<BatchResult> results;  // in manifest order
+  size_t failed = 0;
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds p50{0}, p90{0}, p99{0}, max{0};
+  size_t peak_memory = 0;  // the highest of all scripts
+
+  double Throughput() const;  // scripts per second
+};
+
+// Manifest lines are "script input output"; blank lines and lines starting
+// with '#' are skipped. Throws on malformed lines.
+std::vector<BatchTask> ReadManifest(std::istream& manifest);
+
+// Runs every task in its own Interpreter, with the given limits, on a
+// work-stealing pool. Each distinct script is compiled once, through the
+// cache if there is one, and shared by all of its runs.
+BatchReport RunBatch(
+  const std::vector<BatchTask>& tasks, size_t thread_count, Limits limits = {},
+  const ProgramCache* cache = nullptr
+);
+
+void PrintBatchReport(const BatchReport& report, std::ostream& os);
+
+void RunBatchTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,102 @@
+#include "batch.h"
+
+#include "test_runner.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+struct TempDir {
+  string path;
+
+  TempDir() {
+    char name[] = "/tmp/mython_batch_XXXXXX";
+    if (!mkdtemp(name)) {
+      throw runtime_error("mkdtemp() failed");
+    }
+    path = name;
+  }
+
+  ~TempDir() {
+    system(("rm -rf " + path).c_str());
+  }
+
+  string File(const string& name, const string& content) const {
+    const string file = path + "/" + name;
+    ofstream(file) << content;
+    return file;
+  }
+
+  string Read(const string& name) const {
+    ifstream file(path + "/" + name);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  }
+};
+
+}
+
+void TestReadManifest() {
+  istringstream manifest("# comment\n\na.my in.txt out.txt\nb.my - b.out\n");
+  const auto tasks = ReadManifest(manifest);
+  ASSERT_EQUAL(tasks.size(), 2u);
+  ASSERT_EQUAL(tasks[0].script, "a.my");
+  ASSERT_EQUAL(tasks[0].input, "in.txt");
+  ASSERT_EQUAL(tasks[1].output, "b.out");
+
+  istringstream broken("a.my in.txt\n");
+  ASSERT_THROWS(ReadManifest(broken), invalid_argument);
+}
+
+void TestRunBatch() {
+  TempDir dir;
+  const string echo = dir.File("echo.my", R"(
+line = input()
+count = 0
+while line:
+  count = count + 1
+  print count, line
+  line = input()
+)");
+  const string broken = dir.File("broken.my", "print 1 / 0\n");
+
+  vector<BatchTask> tasks;
+  for (int i = 0; i < 20; ++i) {
+    const string input = dir.File("in" + to_string(i), "a\nb" + to_string(i) + "\n");
+    tasks.push_back({echo, input, dir.path + "/out" + to_string(i)});
+  }
+  tasks.push_back({broken, "-", dir.path + "/broken.out"});
+  tasks.push_back({dir.path + "/missing.my", "-", dir.path + "/missing.out"});
+
+  const BatchReport report = RunBatch(tasks, 3);
+
+  ASSERT_EQUAL(report.results.size(), tasks.size());
+  ASSERT_EQUAL(report.failed, 2u);
+  for (int i = 0; i < 20; ++i) {
+    ASSERT(report.results[i].ok);
+    ASSERT_EQUAL(dir.Read("out" + to_string(i)), "1 a\n2 b" + to_string(i) + "\n");
+  }
+  ASSERT(!report.results[20].ok);
+  ASSERT(!report.results[21].ok);
+  ASSERT(report.p50 <= report.p90 && report.p90 <= report.p99 && report.p99 <= report.max);
+  ASSERT(report.Throughput() > 0);
+
+  ostringstream summary;
+  PrintBatchReport(report, summary);
+  ASSERT(summary.str().find("scripts: 22, failed: 2") != string::npos);
+}
+
+void RunBatchTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestReadManifest);
+  RUN_TEST(tr, Runtime::TestRunBatch);
+}
+
+} /* namespace Runtime */
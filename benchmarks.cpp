@@ -0,0 +1,216 @@
+#include "benchmarks.h"
+#include "object.h"
+#include "statement.h"
+#include "profile.h"
+#include "lexer.h"
+#include "parse.h"
+#include "interpreter.h"
+#include "snapshot.h"
+#include "module.h"
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+const int64_t ELEMENT_COUNT = 1'000'000;
+
+// Compiled before the clock starts, so that only running the script is timed
+shared_ptr<const Runtime::Program> Compile(const char* source) {
+  istringstream input(source);
+  return Runtime::Program::Compile(input);
+}
+
+int64_t GlobalNumber(Runtime::Interpreter& interpreter, const string& name) {
+  return interpreter.Globals().at(name).TryAs<Runtime::Number>()->GetValue();
+}
+
+void BenchmarkList() {
+  auto build = Compile(R"(
+items = []
+for i in range(1000000):
+  items.append(i)
+)");
+  auto sum = Compile(R"(
+total = 0
+for item in items:
+  total = total + item
+)");
+  Runtime::StreamSink sink(cerr);
+  Runtime::Interpreter interpreter(sink);
+  {
+    LOG_DURATION("list: append 1M numbers");
+    interpreter.Run(build);
+  }
+  {
+    LOG_DURATION("list: sum 1M numbers");
+    interpreter.Run(sum);
+  }
+  cerr << "list sum: " << GlobalNumber(interpreter, "total") << endl;
+}
+
+// The way scripts emulated arrays before lists existed: a chain of
+// instances linked through a "next" field.
+void BenchmarkLinkedInstances() {
+  auto build = Compile(R"(
+class Node:
+  def __init__(value, next):
+    self.value = value
+    self.next = next
+
+head = None
+for i in range(1000000):
+  head = Node(999999 - i, head)
+)");
+  auto sum = Compile(R"(
+total = 0
+node = head
+for i in range(1000000):
+  total = total + node.value
+  node = node.next
+)");
+  Runtime::StreamSink sink(cerr);
+  Runtime::Interpreter interpreter(sink);
+  {
+    LOG_DURATION("linked instances: build 1M nodes");
+    interpreter.Run(build);
+  }
+  {
+    LOG_DURATION("linked instances: sum 1M numbers");
+    interpreter.Run(sum);
+  }
+  cerr << "linked instances sum: " << GlobalNumber(interpreter, "total") << endl;
+}
+
+void BenchmarkLoops() {
+  istringstream program(R"(
+total = 0
+for i in range(10000000):
+  total = total + i
+n = 0
+while n < 1000000:
+  n = n + 1
+)");
+  Parse::Lexer lexer(program);
+  auto tree = ParseProgram(lexer);
+  Runtime::Closure closure;
+  {
+    LOG_DURATION("loops: 10M range iterations, 1M while iterations");
+    tree->Execute(closure);
+  }
+  cerr << "loop total: " << closure.at("total").TryAs<Runtime::Number>()->GetValue() << endl;
+
+  // Bodies shaped differently: a plain copy, the accumulator on the right and
+  // a temporary operand
+  auto other_bodies = Compile(R"(
+total = 0
+for i in range(10000000):
+  x = i
+  total = x * 2 + total
+)");
+  Runtime::StreamSink sink(cerr);
+  Runtime::Interpreter interpreter(sink);
+  {
+    LOG_DURATION("loops: 10M range iterations of x = i, total = x * 2 + total");
+    interpreter.Run(other_bodies);
+  }
+  cerr << "loop total: " << GlobalNumber(interpreter, "total") << endl;
+}
+
+// Starting interpreters from a prelude: running it every time versus
+// restoring a snapshot taken after running it once
+void BenchmarkSnapshot() {
+  ostringstream source;
+  for (int i = 0; i < 50; ++i) {
+    source << "class Shape" << i << ":\n"
+           << "  def __init__(size):\n"
+           << "    self.size = size\n"
+           << "  def area():\n"
+           << "    return self.size * " << i << "\n";
+  }
+  source << "shapes = []\n"
+         << "for i in range(100):\n"
+         << "  shapes.append(Shape7(i))\n"
+         << "table = {}\n"
+         << "for i in range(200):\n"
+         << "  table[i] = i * i\n"
+         << "squares = []\n"
+         << "for i in range(2000):\n"
+         << "  squares.append(i * i)\n";
+  istringstream input(source.str());
+  auto prelude = Runtime::Program::Compile(input);
+
+  Runtime::StreamSink sink(cerr);
+  const int starts = 1000;
+  {
+    LOG_DURATION("snapshot: 1000 starts running the prelude");
+    for (int i = 0; i < starts; ++i) {
+      Runtime::Interpreter interpreter(sink);
+      interpreter.Run(prelude);
+    }
+  }
+  Runtime::Interpreter warm(sink);
+  warm.Run(prelude);
+  auto snapshot = Runtime::Snapshot::Capture(warm);
+  {
+    LOG_DURATION("snapshot: 1000 starts restoring a snapshot");
+    for (int i = 0; i < starts; ++i) {
+      Runtime::Interpreter interpreter(sink);
+      snapshot->Restore(interpreter);
+    }
+  }
+}
+
+
+// A host calling one scoring method a million times: looked up by name on
+// every call, through a prepared handle, and through the handle with the
+// interpreter kept bound
+void BenchmarkModuleCalls() {
+  istringstream source(
+    "class Scorer:\n"
+    "  def __init__(weight):\n"
+    "    self.weight = weight\n"
+    "  def score(x):\n"
+    "    return x * self.weight + 1\n"
+  );
+  Runtime::StreamSink sink(cerr);
+  Runtime::Module module(source, sink);
+  ObjectHolder scorer = module.New("Scorer", 3);
+
+  int64_t total = 0;
+  {
+    LOG_DURATION("module: 1M calls by name");
+    for (int64_t i = 0; i < ELEMENT_COUNT; ++i) {
+      total += module.Call<int64_t>(scorer, "score", i);
+    }
+  }
+  const Runtime::MethodHandle score = module.Prepare(module.GetClass("Scorer"), "score");
+  {
+    LOG_DURATION("module: 1M prepared calls");
+    for (int64_t i = 0; i < ELEMENT_COUNT; ++i) {
+      total += score.Call<int64_t>(scorer, i);
+    }
+  }
+  {
+    LOG_DURATION("module: 1M prepared calls in a session");
+    Runtime::Interpreter::Session session(module.GetInterpreter());
+    for (int64_t i = 0; i < ELEMENT_COUNT; ++i) {
+      total += score.Call<int64_t>(scorer, i);
+    }
+  }
+  cerr << "module total: " << total << endl;
+}
+
+}
+
+void RunBenchmarks() {
+  BenchmarkList();
+  BenchmarkLinkedInstances();
+  BenchmarkLoops();
+  BenchmarkSnapshot();
+  BenchmarkModuleCalls();
+}
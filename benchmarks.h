@@ -0,0 +1,4 @@
+#pragma once
+
+// Micro-benchmarks of the runtime object model, reported to stderr.
+void RunBenchmarks();
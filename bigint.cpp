@@ -0,0 +1,248 @@
+#include "bigint.h"
+
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace Runtime {
+
+BigInt::BigInt(int64_t value) : negative(value < 0) {
+  uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  while (magnitude > 0) {
+    limbs.push_back(static_cast<uint32_t>(magnitude % BASE));
+    magnitude /= BASE;
+  }
+}
+
+optional<BigInt> BigInt::Parse(string_view text) {
+  BigInt result;
+  bool negative = false;
+  if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+    negative = text.front() == '-';
+    text.remove_prefix(1);
+  }
+  if (text.empty() || !all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+    return nullopt;
+  }
+
+  for (size_t end = text.size(); end > 0;) {
+    size_t begin = end >= BASE_DIGITS ? end - BASE_DIGITS : 0;
+    uint32_t limb = 0;
+    for (size_t i = begin; i < end; ++i) {
+      limb = limb * 10 + (text[i] - '0');
+    }
+    result.limbs.push_back(limb);
+    end = begin;
+  }
+  result.negative = negative;
+  result.Normalize();
+  return result;
+}
+
+optional<int64_t> BigInt::ToInt64() const {
+  if (limbs.size() > 3) {
+    return nullopt;
+  }
+  unsigned __int128 magnitude = 0;
+  for (auto it = limbs.rbegin(); it != limbs.rend(); ++it) {
+    magnitude = magnitude * BASE + *it;
+  }
+  const unsigned __int128 limit = static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0);
+  if (magnitude > limit) {
+    return nullopt;
+  }
+  uint64_t value = static_cast<uint64_t>(magnitude);
+  return negative ? static_cast<int64_t>(0 - value) : static_cast<int64_t>(value);
+}
+
+double BigInt::ToDouble() const {
+  double result = 0;
+  for (auto it = limbs.rbegin(); it != limbs.rend(); ++it) {
+    result = result * BASE + *it;
+  }
+  return negative ? -result : result;
+}
+
+string BigInt::ToString() const {
+  if (limbs.empty()) {
+    return "0";
+  }
+  string result = negative ? "-" : "";
+  result += to_string(limbs.back());
+  for (auto it = next(limbs.rbegin()); it != limbs.rend(); ++it) {
+    string limb = to_string(*it);
+    result.append(BASE_DIGITS - limb.size(), '0');
+    result += limb;
+  }
+  return result;
+}
+
+int BigInt::CompareMagnitude(const Limbs& lhs, const Limbs& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return lhs.size() < rhs.size() ? -1 : 1;
+  }
+  for (size_t i = lhs.size(); i-- > 0;) {
+    if (lhs[i] != rhs[i]) {
+      return lhs[i] < rhs[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+BigInt::Limbs BigInt::AddMagnitude(const Limbs& lhs, const Limbs& rhs) {
+  Limbs result;
+  result.reserve(max(lhs.size(), rhs.size()) + 1);
+  uint32_t carry = 0;
+  for (size_t i = 0; i < max(lhs.size(), rhs.size()) || carry; ++i) {
+    uint64_t sum = carry;
+    if (i < lhs.size()) sum += lhs[i];
+    if (i < rhs.size()) sum += rhs[i];
+    result.push_back(static_cast<uint32_t>(sum % BASE));
+    carry = static_cast<uint32_t>(sum / BASE);
+  }
+  return result;
+}
+
+// Requires |lhs| >= |rhs|
+BigInt::Limbs BigInt::SubMagnitude(const Limbs& lhs, const Limbs& rhs) {
+  Limbs result = lhs;
+  int64_t borrow = 0;
+  for (size_t i = 0; i < result.size(); ++i) {
+    int64_t diff = static_cast<int64_t>(result[i]) - borrow - (i < rhs.size() ? rhs[i] : 0);
+    borrow = diff < 0 ? 1 : 0;
+    result[i] = static_cast<uint32_t>(diff + borrow * BASE);
+  }
+  Trim(result);
+  return result;
+}
+
+BigInt::Limbs BigInt::MulMagnitude(const Limbs& lhs, const Limbs& rhs) {
+  if (lhs.empty() || rhs.empty()) {
+    return {};
+  }
+  vector<uint64_t> acc(lhs.size() + rhs.size(), 0);
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < rhs.size() || carry; ++j) {
+      uint64_t cur = acc[i + j] + carry + (j < rhs.size() ? static_cast<uint64_t>(lhs[i]) * rhs[j] : 0);
+      acc[i + j] = cur % BASE;
+      carry = cur / BASE;
+    }
+  }
+  Limbs result(acc.begin(), acc.end());
+  Trim(result);
+  return result;
+}
+
+BigInt::Limbs BigInt::MulSmall(const Limbs& lhs, uint32_t rhs) {
+  Limbs result;
+  result.reserve(lhs.size() + 1);
+  uint64_t carry = 0;
+  for (size_t i = 0; i < lhs.size() || carry; ++i) {
+    uint64_t cur = carry + (i < lhs.size() ? static_cast<uint64_t>(lhs[i]) * rhs : 0);
+    result.push_back(static_cast<uint32_t>(cur % BASE));
+    carry = cur / BASE;
+  }
+  Trim(result);
+  return result;
+}
+
+BigInt::Limbs BigInt::DivMagnitude(const Limbs& lhs, const Limbs& rhs) {
+  Limbs quotient(lhs.size(), 0);
+  Limbs remainder;
+  for (size_t i = lhs.size(); i-- > 0;) {
+    remainder.insert(remainder.begin(), lhs[i]);
+    Trim(remainder);
+
+    // Schoolbook long division: binary search for the next quotient limb.
+    uint32_t low = 0, high = BASE - 1;
+    while (low < high) {
+      uint32_t mid = low + (high - low + 1) / 2;
+      if (CompareMagnitude(MulSmall(rhs, mid), remainder) <= 0) {
+        low = mid;
+      } else {
+        high = mid - 1;
+      }
+    }
+    quotient[i] = low;
+    if (low > 0) {
+      remainder = SubMagnitude(remainder, MulSmall(rhs, low));
+    }
+  }
+  Trim(quotient);
+  return quotient;
+}
+
+void BigInt::Trim(Limbs& limbs) {
+  while (!limbs.empty() && limbs.back() == 0) {
+    limbs.pop_back();
+  }
+}
+
+void BigInt::Normalize() {
+  Trim(limbs);
+  if (limbs.empty()) {
+    negative = false;
+  }
+}
+
+BigInt operator+(const BigInt& lhs, const BigInt& rhs) {
+  BigInt result;
+  if (lhs.negative == rhs.negative) {
+    result.limbs = BigInt::AddMagnitude(lhs.limbs, rhs.limbs);
+    result.negative = lhs.negative;
+  } else if (BigInt::CompareMagnitude(lhs.limbs, rhs.limbs) >= 0) {
+    result.limbs = BigInt::SubMagnitude(lhs.limbs, rhs.limbs);
+    result.negative = lhs.negative;
+  } else {
+    result.limbs = BigInt::SubMagnitude(rhs.limbs, lhs.limbs);
+    result.negative = rhs.negative;
+  }
+  result.Normalize();
+  return result;
+}
+
+BigInt operator-(BigInt value) {
+  value.negative = !value.negative;
+  value.Normalize();
+  return value;
+}
+
+BigInt operator-(const BigInt& lhs, const BigInt& rhs) {
+  return lhs + (-rhs);
+}
+
+BigInt operator*(const BigInt& lhs, const BigInt& rhs) {
+  BigInt result;
+  result.limbs = BigInt::MulMagnitude(lhs.limbs, rhs.limbs);
+  result.negative = lhs.negative != rhs.negative;
+  result.Normalize();
+  return result;
+}
+
+BigInt operator/(const BigInt& lhs, const BigInt& rhs) {
+  if (rhs.IsZero()) {
+    throw runtime_error("division by zero");
+  }
+  BigInt result;
+  result.limbs = BigInt::DivMagnitude(lhs.limbs, rhs.limbs);
+  result.negative = lhs.negative != rhs.negative;
+  result.Normalize();
+  return result;
+}
+
+int Compare(const BigInt& lhs, const BigInt& rhs) {
+  if (lhs.negative != rhs.negative) {
+    return lhs.negative ? -1 : 1;
+  }
+  int magnitude = BigInt::CompareMagnitude(lhs.limbs, rhs.limbs);
+  return lhs.negative ? -magnitude : magnitude;
+}
+
+ostream& operator<<(ostream& os, const BigInt& value) {
+  return os << value.ToString();
+}
+
+} /* namespace Runtime */
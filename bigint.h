@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Arbitrary-precision signed integer. Numbers are only promoted to BigInt
+// when a 64-bit operation overflows, so this favours simplicity over speed.
+class BigInt {
+public:
+  BigInt() = default;
+  BigInt(int64_t value);
+
+  static std::optional<BigInt> Parse(std::string_view text);
+
+  bool IsZero() const { return limbs.empty(); }
+  bool IsNegative() const { return negative; }
+  std::optional<int64_t> ToInt64() const;
+  double ToDouble() const;
+  std::string ToString() const;
+
+  friend BigInt operator+(const BigInt& lhs, const BigInt& rhs);
+  friend BigInt operator-(const BigInt& lhs, const BigInt& rhs);
+  friend BigInt operator*(const BigInt& lhs, const BigInt& rhs);
+  // Truncates towards zero, like the built-in integer division
+  friend BigInt operator/(const BigInt& lhs, const BigInt& rhs);
+  friend BigInt operator-(BigInt value);
+
+  friend int Compare(const BigInt& lhs, const BigInt& rhs);
+  friend bool operator==(const BigInt& lhs, const BigInt& rhs) { return Compare(lhs, rhs) == 0; }
+  friend bool operator<(const BigInt& lhs, const BigInt& rhs) { return Compare(lhs, rhs) < 0; }
+
+private:
+  static constexpr uint32_t BASE = 1'000'000'000;
+  static constexpr int BASE_DIGITS = 9;
+
+  using Limbs = std::vector<uint32_t>;
+
+  static int CompareMagnitude(const Limbs& lhs, const Limbs& rhs);
+  static Limbs AddMagnitude(const Limbs& lhs, const Limbs& rhs);
+  static Limbs SubMagnitude(const Limbs& lhs, const Limbs& rhs);
+  static Limbs MulMagnitude(const Limbs& lhs, const Limbs& rhs);
+  static Limbs MulSmall(const Limbs& lhs, uint32_t rhs);
+  static Limbs DivMagnitude(const Limbs& lhs, const Limbs& rhs);
+  static void Trim(Limbs& limbs);
+
+  void Normalize();
+
+  bool negative = false;
+  Limbs limbs;  // little-endian, base 10^9, no leading zero limbs
+};
+
+std::ostream& operator<<(std::ostream& os, const BigInt& value);
+
+void RunBigIntTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,58 @@
+#include "bigint.h"
+
+#include "test_runner.h"
+
+using namespace std;
+
+namespace Runtime {
+
+BigInt Big(const string& text) {
+  return *BigInt::Parse(text);
+}
+
+void TestBigIntParseAndPrint() {
+  ASSERT_EQUAL(Big("0").ToString(), "0");
+  ASSERT_EQUAL(Big("-0").ToString(), "0");
+  ASSERT_EQUAL(Big("000123").ToString(), "123");
+  ASSERT_EQUAL(Big("-1000000000000000000000").ToString(), "-1000000000000000000000");
+  ASSERT_EQUAL(BigInt(INT64_MIN).ToString(), "-9223372036854775808");
+  ASSERT(!BigInt::Parse("12a"));
+  ASSERT(!BigInt::Parse("-"));
+}
+
+void TestBigIntToInt64() {
+  ASSERT_EQUAL(*Big("9223372036854775807").ToInt64(), INT64_MAX);
+  ASSERT_EQUAL(*Big("-9223372036854775808").ToInt64(), INT64_MIN);
+  ASSERT(!Big("9223372036854775808").ToInt64());
+  ASSERT(!Big("-9223372036854775809").ToInt64());
+}
+
+void TestBigIntArithmetic() {
+  ASSERT_EQUAL((Big("999999999999999999") + BigInt(1)).ToString(), "1000000000000000000");
+  ASSERT_EQUAL((BigInt(5) - Big("1000000000000000000000")).ToString(), "-999999999999999999995");
+  ASSERT_EQUAL((Big("-123456789012345678901") + Big("123456789012345678901")).ToString(), "0");
+  ASSERT_EQUAL(
+    (Big("123456789012345678901234567890") * Big("-987654321098765432109876543210")).ToString(),
+    "-121932631137021795226185032733622923332237463801111263526900"
+  );
+  ASSERT_EQUAL((Big("121932631137021795226185032733622923332237463801111263526900") / Big("987654321098765432109876543210")).ToString(),
+    "123456789012345678901234567890");
+  ASSERT_EQUAL((Big("-100000000000000000000") / BigInt(7)).ToString(), "-14285714285714285714");
+  ASSERT_THROWS(BigInt(1) / BigInt(0), runtime_error);
+}
+
+void TestBigIntCompare() {
+  ASSERT(Big("-100000000000000000000") < BigInt(-1));
+  ASSERT(BigInt(-1) < BigInt(0));
+  ASSERT(BigInt(INT64_MAX) < Big("9223372036854775808"));
+  ASSERT(Big("9223372036854775808") == BigInt(INT64_MAX) + BigInt(1));
+}
+
+void RunBigIntTests(TestRunner& tr) {
+  RUN_TEST(tr, TestBigIntParseAndPrint);
+  RUN_TEST(tr, TestBigIntToInt64);
+  RUN_TEST(tr, TestBigIntArithmetic);
+  RUN_TEST(tr, TestBigIntCompare);
+}
+
+} /* namespace Runtime */
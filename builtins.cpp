@@ -0,0 +1,190 @@
+#include "builtins.h"
+#include "arithmetic.h"
+#include "comparators.h"
+#include "format.h"
+#include "hash_table.h"
+#include "interpreter.h"
+#include "object.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace std;
+
+namespace Runtime {
+
+ObjectHolder Length(const ObjectHolder& object) {
+  switch (KindOf(object)) {
+    case ObjectKind::List:
+      return ObjectHolder::Own(Number(static_cast<int64_t>(static_cast<const List&>(*object).Items().size())));
+    case ObjectKind::String:
+      return ObjectHolder::Own(Number(static_cast<int64_t>(static_cast<const String&>(*object).GetValue().size())));
+    case ObjectKind::Dict:
+      return ObjectHolder::Own(Number(static_cast<int64_t>(static_cast<const Dict&>(*object).Table().Size())));
+    default:
+      throw runtime_error("object has no len()");
+  }
+}
+
+ObjectHolder Stringify(const ObjectHolder& object) {
+  string result;
+  if (object) {
+    const_cast<Object&>(*object).PrintTo(result);
+  } else {
+    result.append(NONE_LITERAL);
+  }
+  return MakeString(std::move(result));
+}
+
+namespace {
+
+bool IsNumeric(ObjectKind kind) {
+  return kind == ObjectKind::Number || kind == ObjectKind::BigNumber || kind == ObjectKind::Float;
+}
+
+ObjectHolder BuiltinLen(const ObjectHolder* args, size_t) {
+  return Length(args[0]);
+}
+
+ObjectHolder BuiltinStr(const ObjectHolder* args, size_t) {
+  return Stringify(args[0]);
+}
+
+ObjectHolder BuiltinAbs(const ObjectHolder* args, size_t) {
+  const ObjectHolder& value = args[0];
+  switch (KindOf(value)) {
+    case ObjectKind::Number: {
+      const int64_t number = static_cast<const Number&>(*value).GetValue();
+      return number >= 0 ? value : MakeInteger(-BigInt(number));
+    }
+    case ObjectKind::BigNumber: {
+      const BigInt& number = static_cast<const BigNumber&>(*value).GetValue();
+      return number < BigInt(0) ? MakeInteger(-number) : value;
+    }
+    case ObjectKind::Float:
+      return ObjectHolder::Own(Float(std::fabs(static_cast<const Float&>(*value).GetValue())));
+    default:
+      throw runtime_error("bad operand type for abs()");
+  }
+}
+
+// min and max take either several values or a single list
+template <CompareOp op>
+ObjectHolder BuiltinExtremum(const ObjectHolder* args, size_t count) {
+  if (count == 1 && KindOf(args[0]) == ObjectKind::List) {
+    const auto& items = static_cast<const List&>(*args[0]).Items();
+    if (items.empty()) {
+      throw runtime_error("min() or max() of an empty list");
+    }
+    args = items.data();
+    count = items.size();
+  }
+  const ObjectHolder* best = &args[0];
+  for (size_t i = 1; i < count; ++i) {
+    if (Compare(op, args[i], *best)) {
+      best = &args[i];
+    }
+  }
+  return *best;
+}
+
+ObjectHolder ParseInteger(const string& text) {
+  if (auto value = BigInt::Parse(text)) {
+    return MakeInteger(*value);
+  }
+  throw runtime_error("invalid literal for int(): '" + text + "'");
+}
+
+ObjectHolder BuiltinInt(const ObjectHolder* args, size_t) {
+  const ObjectHolder& value = args[0];
+  switch (KindOf(value)) {
+    case ObjectKind::Number:
+    case ObjectKind::BigNumber:
+      return value;
+    case ObjectKind::Bool:
+      return ObjectHolder::Own(Number(static_cast<const Bool&>(*value).GetValue() ? 1 : 0));
+    case ObjectKind::Float: {
+      const double number = std::trunc(static_cast<const Float&>(*value).GetValue());
+      if (!std::isfinite(number)) {
+        throw runtime_error("cannot convert infinity or NaN to integer");
+      }
+      if (number >= -9.2e18 && number <= 9.2e18) {
+        return ObjectHolder::Own(Number(static_cast<int64_t>(number)));
+      }
+      char digits[400];
+      std::snprintf(digits, sizeof(digits), "%.0f", number);
+      return ParseInteger(digits);
+    }
+    case ObjectKind::String:
+      return ParseInteger(static_cast<const String&>(*value).GetValue());
+    default:
+      throw runtime_error("int() argument must be a string or a number");
+  }
+}
+
+ObjectHolder BuiltinFloat(const ObjectHolder* args, size_t) {
+  const ObjectHolder& value = args[0];
+  const ObjectKind kind = KindOf(value);
+  if (IsNumeric(kind)) {
+    return kind == ObjectKind::Float ? value : ObjectHolder::Own(Float(ToDouble(*value)));
+  }
+  if (kind == ObjectKind::String) {
+    const string& text = static_cast<const String&>(*value).GetValue();
+    char* end = nullptr;
+    const double number = std::strtod(text.c_str(), &end);
+    if (text.empty() || end != text.c_str() + text.size()) {
+      throw runtime_error("could not convert string to float: '" + text + "'");
+    }
+    return ObjectHolder::Own(Float(number));
+  }
+  throw runtime_error("float() argument must be a string or a number");
+}
+
+// Next line of the running interpreter's input, None once it is exhausted
+ObjectHolder BuiltinInput(const ObjectHolder*, size_t) {
+  Interpreter* interpreter = Interpreter::Current();
+  std::istream* input = interpreter ? interpreter->Input() : nullptr;
+  string line;
+  if (!input || !getline(*input, line)) {
+    return ObjectHolder::None();
+  }
+  return MakeString(std::move(line));
+}
+
+ObjectHolder BuiltinHash(const ObjectHolder* args, size_t) {
+  return ObjectHolder::Own(Number(static_cast<int64_t>(HashKey(args[0]))));
+}
+
+}
+
+BuiltinRegistry& BuiltinRegistry::Instance() {
+  static BuiltinRegistry registry;
+  return registry;
+}
+
+BuiltinRegistry::BuiltinRegistry() {
+  Register("len", 1, 1, BuiltinLen);
+  Register("str", 1, 1, BuiltinStr);
+  Register("abs", 1, 1, BuiltinAbs);
+  Register("min", 1, SIZE_MAX, BuiltinExtremum<CompareOp::Less>);
+  Register("max", 1, SIZE_MAX, BuiltinExtremum<CompareOp::Greater>);
+  Register("int", 1, 1, BuiltinInt);
+  Register("float", 1, 1, BuiltinFloat);
+  Register("hash", 1, 1, BuiltinHash);
+  Register("input", 0, 0, BuiltinInput);
+}
+
+void BuiltinRegistry::Register(std::string name, size_t min_args, size_t max_args, BuiltinFunction function) {
+  Builtin builtin{name, min_args, max_args, function};
+  builtins[std::move(name)] = std::move(builtin);
+}
+
+const Builtin* BuiltinRegistry::Find(const std::string& name) const {
+  auto it = builtins.find(name);
+  return it != builtins.end() ? &it->second : nullptr;
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "object_holder.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Native function callable from scripts. Arguments arrive already evaluated,
+// their number is checked against the builtin's arity when the call is parsed.
+using BuiltinFunction = ObjectHolder (*)(const ObjectHolder* args, size_t count);
+
+struct Builtin {
+  std::string name;
+  size_t min_args;
+  size_t max_args;
+  BuiltinFunction function;
+};
+
+// Functions the parser resolves by name, so a call compiles straight to a
+// function pointer. The standard builtins are registered on first use; hosts
+// may add their own before parsing a program.
+class BuiltinRegistry {
+public:
+  static BuiltinRegistry& Instance();
+
+  void Register(std::string name, size_t min_args, size_t max_args, BuiltinFunction function);
+  const Builtin* Find(const std::string& name) const;
+
+private:
+  BuiltinRegistry();
+
+  std::unordered_map<std::string, Builtin> builtins;
+};
+
+// len(object) and str(object); str is shared with the Stringify node
+ObjectHolder Length(const ObjectHolder& object);
+ObjectHolder Stringify(const ObjectHolder& object);
+
+void RunBuiltinsTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,59 @@
+#include "builtins.h"
+#include "object.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+using namespace std;
+
+namespace Runtime {
+
+ObjectHolder Call(const string& name, vector<ObjectHolder> args) {
+  const Builtin* builtin = BuiltinRegistry::Instance().Find(name);
+  ASSERT(builtin);
+  return builtin->function(args.data(), args.size());
+}
+
+int64_t IntValue(const ObjectHolder& object) {
+  return object.TryAs<Number>()->GetValue();
+}
+
+void TestStandardBuiltins() {
+  ASSERT_EQUAL(IntValue(Call("len", {ObjectHolder::Own(String("four"))})), 4);
+  ASSERT_EQUAL(IntValue(Call("abs", {ObjectHolder::Own(Number(-5))})), 5);
+  ASSERT_EQUAL(Call("abs", {ObjectHolder::Own(Number(INT64_MIN))}).TryAs<BigNumber>()->GetValue().ToString(),
+               "9223372036854775808");
+  ASSERT_EQUAL(IntValue(Call("min", {ObjectHolder::Own(Number(3)), ObjectHolder::Own(Number(-1))})), -1);
+  ASSERT_EQUAL(IntValue(Call("int", {ObjectHolder::Own(Float(-2.75))})), -2);
+  ASSERT_EQUAL(IntValue(Call("int", {ObjectHolder::Own(String("-17"))})), -17);
+  ASSERT_EQUAL(Call("float", {ObjectHolder::Own(String("0.5"))}).TryAs<Float>()->GetValue(), 0.5);
+  ASSERT_EQUAL(IntValue(Call("hash", {ObjectHolder::Own(Number(1))})),
+               IntValue(Call("hash", {ObjectHolder::Own(Float(1.0))})));
+
+  ASSERT_THROWS(Call("int", {ObjectHolder::Own(String("12x"))}), runtime_error);
+  ASSERT_THROWS(Call("max", {ObjectHolder::Own(List())}), runtime_error);
+  ASSERT_THROWS(Call("len", {ObjectHolder::None()}), runtime_error);
+  ASSERT(!BuiltinRegistry::Instance().Find("print"));
+}
+
+ObjectHolder Twice(const ObjectHolder* args, size_t) {
+  return ObjectHolder::Own(Number(2 * args[0].TryAs<Number>()->GetValue()));
+}
+
+void TestHostBuiltins() {
+  BuiltinRegistry::Instance().Register("twice", 1, 1, Twice);
+  const Builtin* twice = BuiltinRegistry::Instance().Find("twice");
+  ASSERT(twice && twice->function == Twice);
+
+  vector<unique_ptr<Ast::Statement>> args;
+  args.push_back(make_unique<Ast::NumericConst>(21));
+  Closure closure;
+  ASSERT_EQUAL(IntValue(Ast::BuiltinCall(*twice, std::move(args)).Execute(closure)), 42);
+}
+
+void RunBuiltinsTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestStandardBuiltins);
+  RUN_TEST(tr, Runtime::TestHostBuiltins);
+}
+
+} /* namespace Runtime */
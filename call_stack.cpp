@@ -0,0 +1,180 @@
+#include "call_stack.h"
+#include "object.h"
+
+#include <exception>
+#include <memory>
+#include <utility>
+
+#include <pthread.h>
+#include <ucontext.h>
+
+namespace Runtime {
+
+namespace {
+thread_local CallStack* bound_stack = nullptr;
+}
+
+CallStack& CallStack::Current() {
+  if (bound_stack) {
+    return *bound_stack;
+  }
+  thread_local CallStack stack;
+  return stack;
+}
+
+CallStack* CallStack::Bind(CallStack* stack) {
+  return std::exchange(bound_stack, stack);
+}
+
+void CallStack::Push(const ClassInstance& instance, const std::string& method) {
+  CountStep();
+  if (frames.size() >= max_depth) {
+    throw RecursionError("maximum recursion depth exceeded in " + method);
+  }
+  char marker;
+  if (native_limit && &marker < native_limit) {
+    throw RecursionError("interpreter stack exhausted in " + method);
+  }
+  frames.push_back({&instance, &method});
+}
+
+namespace {
+// The innermost interpreter stack running on this thread
+thread_local InterpreterStack* running_stack = nullptr;
+
+// makecontext passes only int arguments, so the stack travels through here
+thread_local InterpreterStack* starting_stack = nullptr;
+
+// Unwinds a cancelled stack; deliberately not a std::exception
+struct Cancelled {};
+}
+
+struct InterpreterStack::Contexts {
+  ucontext_t own;
+  ucontext_t caller;
+};
+
+InterpreterStack::InterpreterStack(std::function<void()> fn, size_t max_depth, bool suspendable)
+  : fn(std::move(fn))
+  // Left uninitialized: only the pages a script actually reaches get touched
+  , memory(new char[max_depth * NATIVE_BYTES_PER_CALL + NATIVE_STACK_RESERVE])
+  , size(max_depth * NATIVE_BYTES_PER_CALL + NATIVE_STACK_RESERVE)
+  , suspendable(suspendable)
+  , contexts(std::make_unique<Contexts>())
+{
+  if (getcontext(&contexts->own) != 0) {
+    throw std::runtime_error("cannot create interpreter stack");
+  }
+  contexts->own.uc_stack.ss_sp = memory.get();
+  contexts->own.uc_stack.ss_size = size;
+  contexts->own.uc_link = &contexts->caller;
+  makecontext(&contexts->own, Start, 0);
+}
+
+InterpreterStack::~InterpreterStack() {
+  Cancel();
+}
+
+void InterpreterStack::Cancel() {
+  if (started && !done) {
+    cancelled = true;
+    const size_t outer_steps = std::exchange(steps_left, SIZE_MAX);
+    try {
+      Resume();
+    } catch (...) {
+    }
+    steps_left = outer_steps;
+  }
+}
+
+void InterpreterStack::Start() {
+  InterpreterStack* stack = starting_stack;
+  try {
+    stack->fn();
+  } catch (const Cancelled&) {
+  } catch (...) {
+    stack->error = std::current_exception();
+  }
+  stack->done = true;
+}
+
+bool InterpreterStack::Resume() {
+  if (done) {
+    return true;
+  }
+  CallStack& calls = CallStack::Current();
+  const char* outer_limit = calls.NativeLimit();
+  calls.SetNativeLimit(memory.get() + NATIVE_STACK_RESERVE);
+  outer = std::exchange(running_stack, this);
+  starting_stack = this;
+  started = true;
+  const int status = swapcontext(&contexts->caller, &contexts->own);
+  running_stack = outer;
+  calls.SetNativeLimit(outer_limit);
+
+  if (status != 0) {
+    throw std::runtime_error("cannot switch to interpreter stack");
+  }
+  if (done && error) {
+    std::rethrow_exception(std::exchange(error, nullptr));
+  }
+  return done;
+}
+
+void InterpreterStack::Suspend() {
+  if (swapcontext(&contexts->own, &contexts->caller) != 0) {
+    throw std::runtime_error("cannot switch from interpreter stack");
+  }
+  if (cancelled) {
+    throw Cancelled{};
+  }
+}
+
+void OnStepsExhausted() {
+  InterpreterStack* stack = running_stack;
+  if (stack && stack->suspendable) {
+    // Resume sets the budget of the next slice
+    stack->Suspend();
+    return;
+  }
+  while (stack && !stack->suspendable) {
+    stack = stack->outer;
+  }
+  // Inside a nested run the enclosing task stops at the first safe point
+  // after the run returns
+  steps_left = stack ? 1 : SIZE_MAX;
+}
+
+void RunOnInterpreterStack(const std::function<void()>& fn) {
+  InterpreterStack stack(fn, CallStack::Current().MaxDepth(), false);
+  stack.Resume();
+}
+
+void CheckNativeStack(const char* what) {
+  char marker;
+  const char* limit = CallStack::Current().NativeLimit();
+  if (limit && &marker < limit) {
+    throw RecursionError(std::string("interpreter stack exhausted in ") + what);
+  }
+}
+
+const char* ThreadStackLimit() {
+  // pthread_getattr_np may read /proc for the main thread, so ask only once
+  thread_local const char* limit = [] {
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+      return static_cast<const char*>(nullptr);
+    }
+    void* lowest = nullptr;
+    size_t size = 0;
+    pthread_attr_getstack(&attributes, &lowest, &size);
+    pthread_attr_destroy(&attributes);
+    if (!lowest || size <= 2 * NATIVE_STACK_RESERVE) {
+      return static_cast<const char*>(nullptr);
+    }
+    return static_cast<const char*>(lowest) + NATIVE_STACK_RESERVE;
+  }();
+  return limit;
+}
+
+} /* namespace Runtime */
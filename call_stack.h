@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+class ClassInstance;
+
+// Raised when a script recurses deeper than the interpreter allows, instead
+// of overflowing the native stack.
+class RecursionError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+struct Frame {
+  const ClassInstance* instance;
+  const std::string* method;
+};
+
+// Mython method frames of the interpreter running on this thread, kept in one
+// contiguous buffer. The depth is capped, and while the interpreter runs on
+// its own stack (see RunOnInterpreterStack) every call also checks that
+// enough native stack is left.
+class CallStack {
+public:
+  static constexpr size_t DEFAULT_MAX_DEPTH = 10'000;
+
+  static CallStack& Current();
+  // Makes stack the current one of this thread (nullptr restores the thread's
+  // own) and returns the previously bound stack
+  static CallStack* Bind(CallStack* stack);
+
+  void Push(const ClassInstance& instance, const std::string& method);
+  void Pop() { frames.pop_back(); }
+
+  size_t Depth() const { return frames.size(); }
+  const std::vector<Frame>& Frames() const { return frames; }
+
+  size_t MaxDepth() const { return max_depth; }
+  void SetMaxDepth(size_t depth) { max_depth = depth; }
+
+  // Calls fail once the native stack reaches below this address
+  const char* NativeLimit() const { return native_limit; }
+  void SetNativeLimit(const char* limit) { native_limit = limit; }
+
+  // Keeps a frame pushed for the lifetime of the scope
+  class Scope {
+  public:
+    Scope(const ClassInstance& instance, const std::string& method) : stack(Current()) {
+      stack.Push(instance, method);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope() { stack.Pop(); }
+
+  private:
+    CallStack& stack;
+  };
+
+private:
+  std::vector<Frame> frames;
+  size_t max_depth = DEFAULT_MAX_DEPTH;
+  const char* native_limit = nullptr;
+};
+
+// Steps the running script may take before it reaches a suspension point.
+// Outside a resumable stack it never runs out in practice.
+inline thread_local size_t steps_left = SIZE_MAX;
+
+void OnStepsExhausted();
+
+// Called between statements and on every method call, the only points at
+// which a script may be suspended
+inline void CountStep() {
+  if (--steps_left == 0) {
+    OnStepsExhausted();
+  }
+}
+
+// Native stack budgeted per Mython call, and the part of the stack kept free
+// below the limit for the code running between two calls
+constexpr size_t NATIVE_BYTES_PER_CALL = 4096;
+constexpr size_t NATIVE_STACK_RESERVE = 256 * 1024;
+
+// Runs fn on a heap-allocated native stack sized for the current maximum
+// depth, so script recursion neither depends on nor can overflow the stack
+// of the calling thread. Exceptions thrown by fn are rethrown here.
+void RunOnInterpreterStack(const std::function<void()>& fn);
+
+// For C++ code that recurses over nested objects, such as printing or comparing
+// lists: throws RecursionError once the native stack reaches the current limit
+void CheckNativeStack(const char* what);
+
+// Native limit for calls made on the calling thread's own stack: its lowest
+// address plus NATIVE_STACK_RESERVE, or nullptr if it cannot be determined
+const char* ThreadStackLimit();
+
+// An interpreter stack that can be left in the middle of fn and entered again.
+// A suspendable stack gives up control at the first CountStep after
+// steps_left reaches zero; Resume then returns false. Destroying a suspended
+// stack unwinds fn, so everything it holds is released. A stack must always be
+// resumed on the thread that started it.
+class InterpreterStack {
+public:
+  InterpreterStack(std::function<void()> fn, size_t max_depth, bool suspendable);
+  InterpreterStack(const InterpreterStack&) = delete;
+  InterpreterStack& operator=(const InterpreterStack&) = delete;
+  ~InterpreterStack();
+
+  // Runs fn until it returns or suspends. Returns true once fn has returned
+  // and rethrows the exception it exited with.
+  bool Resume();
+  bool Done() const { return done; }
+  // Unwinds a suspended fn; the destructor does this too
+  void Cancel();
+
+private:
+  friend void OnStepsExhausted();
+  static void Start();
+  void Suspend();
+
+  std::function<void()> fn;
+  std::unique_ptr<char[]> memory;
+  size_t size;
+  bool suspendable;
+  bool started = false;
+  bool done = false;
+  bool cancelled = false;
+  std::exception_ptr error;
+  struct Contexts;
+  std::unique_ptr<Contexts> contexts;
+  InterpreterStack* outer = nullptr;
+};
+
+void RunCallStackTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,59 @@
+#include "call_stack.h"
+#include "object.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+using namespace std;
+
+namespace Runtime {
+
+void TestCallStackDepthLimit() {
+  Class cls("Empty", {}, nullptr);
+  ClassInstance instance(cls);
+  const string method = "recurse";
+
+  CallStack& stack = CallStack::Current();
+  const size_t outer_max_depth = stack.MaxDepth();
+  stack.SetMaxDepth(3);
+  {
+    CallStack::Scope first(instance, method);
+    CallStack::Scope second(instance, method);
+    CallStack::Scope third(instance, method);
+    ASSERT_EQUAL(stack.Depth(), 3u);
+    ASSERT(stack.Frames().back().instance == &instance);
+    ASSERT_THROWS(stack.Push(instance, method), RecursionError);
+    ASSERT_EQUAL(stack.Depth(), 3u);
+  }
+  ASSERT_EQUAL(stack.Depth(), 0u);
+  stack.SetMaxDepth(outer_max_depth);
+}
+
+size_t Descend(size_t depth) {
+  volatile char frame[NATIVE_BYTES_PER_CALL / 2];
+  frame[0] = static_cast<char>(depth);
+  return depth == 0 ? frame[0] : Descend(depth - 1) + 1;
+}
+
+void TestInterpreterStack() {
+  size_t result = 0;
+  // About 20 MiB deep, more than a default thread stack has
+  RunOnInterpreterStack([&result] { result = Descend(CallStack::DEFAULT_MAX_DEPTH); });
+  ASSERT_EQUAL(result, CallStack::DEFAULT_MAX_DEPTH);
+
+  ASSERT_THROWS(RunOnInterpreterStack([] { throw RecursionError("inner"); }), RecursionError);
+  ASSERT(CallStack::Current().NativeLimit() == nullptr);
+
+  bool nested = false;
+  RunOnInterpreterStack([&nested] {
+    RunOnInterpreterStack([&nested] { nested = true; });
+  });
+  ASSERT(nested);
+}
+
+void RunCallStackTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestCallStackDepthLimit);
+  RUN_TEST(tr, Runtime::TestInterpreterStack);
+}
+
+} /* namespace Runtime */
@@ -1,68 +1,144 @@
 #include "comparators.h"
+#include "arithmetic.h"
+#include "call_stack.h"
 #include "object.h"
 #include "object_holder.h"
 
-#include <functional>
-#include <optional>
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <type_traits>
 
 using namespace std;
 
 namespace Runtime {
 
-template <typename T>
-std::optional<bool> EqualValue(ObjectHolder lhs, ObjectHolder rhs) {
-    auto lhs_val = lhs.TryAs<T>();
-    auto rhs_val = rhs.TryAs<T>();
-    if (lhs_val && rhs_val) {
-        return std::optional(lhs_val->GetValue() == rhs_val->GetValue());
-    }
-    return std::optional<bool>();
+namespace {
+
+using CompareFn = bool (*)(CompareOp, const ObjectHolder&, const ObjectHolder&);
+
+constexpr size_t KIND_COUNT = static_cast<size_t>(ObjectKind::Count);
+
+// Every operator is derived from "less" and "equal" the same way for all
+// operand types: Greater is neither less nor equal, LessOrEqual is not
+// greater and GreaterOrEqual is not less.
+bool Derive(CompareOp op, bool less, bool equal) {
+  switch (op) {
+    case CompareOp::Equal: return equal;
+    case CompareOp::NotEqual: return !equal;
+    case CompareOp::Less: return less;
+    case CompareOp::Greater: return !less && !equal;
+    case CompareOp::LessOrEqual: return less || equal;
+    case CompareOp::GreaterOrEqual: return !less;
+  }
+  return false;
 }
 
 template <typename T>
-std::optional<bool> LessValue(ObjectHolder lhs, ObjectHolder rhs) {
-    auto lhs_val = lhs.TryAs<T>();
-    auto rhs_val = rhs.TryAs<T>();
-    if (lhs_val && rhs_val) {
-        return std::optional(lhs_val->GetValue() < rhs_val->GetValue());
+bool CompareValues(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+  if constexpr (std::is_same_v<T, String>) {
+    if (op == CompareOp::Equal || op == CompareOp::NotEqual) {
+      bool equal = static_cast<const String&>(*lhs) == static_cast<const String&>(*rhs);
+      return op == CompareOp::Equal ? equal : !equal;
     }
-    return std::optional<bool>();
+  }
+  const auto& lhs_val = static_cast<const T&>(*lhs).GetValue();
+  const auto& rhs_val = static_cast<const T&>(*rhs).GetValue();
+  switch (op) {
+    case CompareOp::Equal: return lhs_val == rhs_val;
+    case CompareOp::NotEqual: return !(lhs_val == rhs_val);
+    case CompareOp::Less: return lhs_val < rhs_val;
+    default: return Derive(op, lhs_val < rhs_val, lhs_val == rhs_val);
+  }
 }
 
+bool CompareIntegers(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+  int order = Compare(ToBigInt(*lhs), ToBigInt(*rhs));
+  return Derive(op, order < 0, order == 0);
+}
+
+bool CompareFloats(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+  double lhs_val = ToDouble(*lhs);
+  double rhs_val = ToDouble(*rhs);
+  return Derive(op, lhs_val < rhs_val, lhs_val == rhs_val);
+}
+
+bool CompareLists(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+  const auto& lhs_items = static_cast<const List&>(*lhs).Items();
+  const auto& rhs_items = static_cast<const List&>(*rhs).Items();
+  CheckNativeStack("comparison");
+  // Lexicographic: the first pair of unequal items decides. An item is equal
+  // to itself without a comparison, as in Python, so a list that contains
+  // itself equals itself; two distinct cycles raise RecursionError.
+  size_t common = min(lhs_items.size(), rhs_items.size());
+  for (size_t i = 0; i < common; ++i) {
+    const bool same = lhs_items[i] && lhs_items[i].Get() == rhs_items[i].Get();
+    if (!same && !Compare(CompareOp::Equal, lhs_items[i], rhs_items[i])) {
+      if (op == CompareOp::Equal || op == CompareOp::NotEqual) {
+        return op == CompareOp::NotEqual;
+      }
+      return Derive(op, Compare(CompareOp::Less, lhs_items[i], rhs_items[i]), false);
+    }
+  }
+  return Derive(op, lhs_items.size() < rhs_items.size(), lhs_items.size() == rhs_items.size());
+}
 
-bool Equal(ObjectHolder lhs, ObjectHolder rhs) {
-    auto option = EqualValue<Runtime::String>(lhs, rhs);
-    if (option.has_value()) { return option.value(); }
+bool CompareUnrelated(CompareOp op, const ObjectHolder&, const ObjectHolder&) {
+  return Derive(op, false, false);
+}
 
-    option = EqualValue<Runtime::Number>(lhs, rhs);
-    if (option.has_value()) { return option.value(); }
-    
-    option = EqualValue<Runtime::Bool>(lhs, rhs);
-    if (option.has_value()) { return option.value(); }
-    
+bool CallComparison(ObjectHolder lhs, const char* method, const ObjectHolder& rhs) {
+  auto& instance = static_cast<ClassInstance&>(*lhs);
+  if (!instance.HasMethod(method, 1)) {
     return false;
+  }
+  return IsTrue(instance.Call(method, {rhs}));
 }
 
+bool CompareInstance(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+  switch (op) {
+    case CompareOp::Equal: return CallComparison(lhs, "__eq__", rhs);
+    case CompareOp::NotEqual: return !CallComparison(lhs, "__eq__", rhs);
+    case CompareOp::Less: return CallComparison(lhs, "__lt__", rhs);
+    case CompareOp::GreaterOrEqual: return !CallComparison(lhs, "__lt__", rhs);
+    default: return Derive(op, CallComparison(lhs, "__lt__", rhs), CallComparison(lhs, "__eq__", rhs));
+  }
+}
 
+using CompareTable = array<array<CompareFn, KIND_COUNT>, KIND_COUNT>;
 
-bool Less(ObjectHolder lhs, ObjectHolder rhs) {
-    auto option = LessValue<Runtime::String>(lhs, rhs);
-    if (option.has_value()) {
-        return option.value();
-    }
+CompareTable BuildCompareTable() {
+  CompareTable table;
+  for (auto& row : table) {
+    row.fill(CompareUnrelated);
+  }
 
-    option = LessValue<Runtime::Number>(lhs, rhs);
-    if (option.has_value()) {
-        return option.value();
-    }
+  auto set = [&table](ObjectKind lhs, ObjectKind rhs, CompareFn fn) {
+    table[static_cast<size_t>(lhs)][static_cast<size_t>(rhs)] = fn;
+  };
+  set(ObjectKind::String, ObjectKind::String, CompareValues<String>);
+  set(ObjectKind::Number, ObjectKind::Number, CompareValues<Number>);
+  set(ObjectKind::Bool, ObjectKind::Bool, CompareValues<Bool>);
+  set(ObjectKind::Number, ObjectKind::BigNumber, CompareIntegers);
+  set(ObjectKind::BigNumber, ObjectKind::Number, CompareIntegers);
+  set(ObjectKind::BigNumber, ObjectKind::BigNumber, CompareIntegers);
+  for (ObjectKind number : {ObjectKind::Number, ObjectKind::BigNumber, ObjectKind::Float}) {
+    set(ObjectKind::Float, number, CompareFloats);
+    set(number, ObjectKind::Float, CompareFloats);
+  }
+  set(ObjectKind::List, ObjectKind::List, CompareLists);
+  for (size_t rhs = 0; rhs < KIND_COUNT; ++rhs) {
+    set(ObjectKind::Instance, static_cast<ObjectKind>(rhs), CompareInstance);
+  }
+  return table;
+}
+
+const CompareTable COMPARE_TABLE = BuildCompareTable();
 
-    option = LessValue<Runtime::Bool>(lhs, rhs);
-    if (option.has_value()) {
-        return option.value();
-    }
-    return false;
 }
 
+bool Compare(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+  auto fn = COMPARE_TABLE[static_cast<size_t>(KindOf(lhs))][static_cast<size_t>(KindOf(rhs))];
+  return fn(op, lhs, rhs);
+}
 
 } /* namespace Runtime */
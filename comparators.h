@@ -4,23 +4,39 @@
 
 namespace Runtime {
 
-bool Equal(ObjectHolder lhs, ObjectHolder rhs);
-bool Less(ObjectHolder lhs, ObjectHolder rhs);
+enum class CompareOp {
+  Equal,
+  NotEqual,
+  Less,
+  Greater,
+  LessOrEqual,
+  GreaterOrEqual
+};
+
+bool Compare(CompareOp op, const ObjectHolder& lhs, const ObjectHolder& rhs);
+
+inline bool Equal(ObjectHolder lhs, ObjectHolder rhs) {
+  return Compare(CompareOp::Equal, lhs, rhs);
+}
+
+inline bool Less(ObjectHolder lhs, ObjectHolder rhs) {
+  return Compare(CompareOp::Less, lhs, rhs);
+}
 
 inline bool NotEqual(ObjectHolder lhs, ObjectHolder rhs) {
-  return !Equal(lhs, rhs);
+  return Compare(CompareOp::NotEqual, lhs, rhs);
 }
 
 inline bool Greater(ObjectHolder lhs, ObjectHolder rhs) {
-  return !Less(lhs, rhs) && !Equal(lhs, rhs);
+  return Compare(CompareOp::Greater, lhs, rhs);
 }
 
 inline bool LessOrEqual(ObjectHolder lhs, ObjectHolder rhs) {
-  return !Greater(lhs, rhs);
+  return Compare(CompareOp::LessOrEqual, lhs, rhs);
 }
 
 inline bool GreaterOrEqual(ObjectHolder lhs, ObjectHolder rhs) {
-  return !Less(lhs, rhs);
+  return Compare(CompareOp::GreaterOrEqual, lhs, rhs);
 }
 
 } /* namespace Runtime */
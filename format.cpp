@@ -0,0 +1,37 @@
+#include "format.h"
+
+#include <charconv>
+#include <cstdint>
+
+namespace Runtime {
+
+void AppendNumber(std::string& buffer, int64_t value) {
+  char digits[24];
+  auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+  buffer.append(digits, end);
+}
+
+void AppendFloat(std::string& buffer, double value) {
+  char digits[32];
+  auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+  std::string_view text(digits, end - digits);
+  buffer.append(text);
+  // Keep floats distinguishable from integers: 2.0 is printed as "2.0"
+  if (text.find_first_not_of("-0123456789") == std::string_view::npos) {
+    buffer.append(".0");
+  }
+}
+
+void AppendPointer(std::string& buffer, const void* pointer) {
+  if (pointer == nullptr) {
+    buffer.append("0");
+    return;
+  }
+  char digits[2 + 2 * sizeof(std::uintptr_t)] = {'0', 'x'};
+  auto [end, ec] = std::to_chars(
+    digits + 2, std::end(digits), reinterpret_cast<std::uintptr_t>(pointer), 16
+  );
+  buffer.append(digits, end);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Runtime {
+
+inline constexpr std::string_view TRUE_LITERAL = "True";
+inline constexpr std::string_view FALSE_LITERAL = "False";
+inline constexpr std::string_view NONE_LITERAL = "None";
+
+void AppendNumber(std::string& buffer, int64_t value);
+void AppendFloat(std::string& buffer, double value);
+void AppendPointer(std::string& buffer, const void* pointer);
+
+inline void AppendBool(std::string& buffer, bool value) {
+  buffer.append(value ? TRUE_LITERAL : FALSE_LITERAL);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,184 @@
+#include "hash_table.h"
+#include "arithmetic.h"
+#include "comparators.h"
+#include "object.h"
+
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+size_t MixInteger(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  return static_cast<size_t>(value);
+}
+
+size_t HashDouble(double value) {
+  if (value >= -9.2e18 && value <= 9.2e18 && value == std::trunc(value)) {
+    return MixInteger(static_cast<uint64_t>(static_cast<int64_t>(value)));
+  }
+  return std::hash<double>{}(value);
+}
+
+}
+
+size_t HashKey(const ObjectHolder& key) {
+  switch (KindOf(key)) {
+    case ObjectKind::String:
+      return static_cast<const String&>(*key).Hash();
+    case ObjectKind::Number:
+      return MixInteger(static_cast<uint64_t>(static_cast<const Number&>(*key).GetValue()));
+    case ObjectKind::BigNumber:
+    case ObjectKind::Float:
+      return HashDouble(ToDouble(*key));
+    case ObjectKind::Bool:
+      return static_cast<const Bool&>(*key).GetValue() ? 0x9e3779b97f4a7c15ULL : 0x7f4a7c159e3779b9ULL;
+    default:
+      throw runtime_error("unhashable type used as a dictionary key");
+  }
+}
+
+uint32_t HashTable::MatchByte(size_t group, int8_t byte) const {
+  const int8_t* ctrl = control.data() + group * GROUP_WIDTH;
+#ifdef __SSE2__
+  __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte))));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+    mask |= static_cast<uint32_t>(ctrl[i] == byte) << i;
+  }
+  return mask;
+#endif
+}
+
+uint32_t HashTable::MatchFree(size_t group) const {
+  return MatchByte(group, EMPTY) | MatchByte(group, DELETED);
+}
+
+// Probes groups in triangular order, which visits every group exactly once
+// when the number of groups is a power of two.
+HashTable::Slot HashTable::Locate(const ObjectHolder& key, size_t hash) const {
+  if (control.empty()) {
+    return {0, false};
+  }
+  const size_t group_mask = control.size() / GROUP_WIDTH - 1;
+  const int8_t tag = static_cast<int8_t>(hash & 0x7F);
+  size_t group = (hash >> 7) & group_mask;
+  for (size_t step = 1; step <= group_mask + 1; ++step) {
+    for (uint32_t mask = MatchByte(group, tag); mask != 0; mask &= mask - 1) {
+      size_t position = group * GROUP_WIDTH + __builtin_ctz(mask);
+      const Entry& entry = entries[slots[position]];
+      if (entry.hash == hash && (entry.key.Get() == key.Get() || Compare(CompareOp::Equal, entry.key, key))) {
+        return {position, true};
+      }
+    }
+    if (MatchByte(group, EMPTY) != 0) {
+      break;
+    }
+    group = (group + step) & group_mask;
+  }
+  return {0, false};
+}
+
+size_t HashTable::FindInsertPosition(size_t hash) const {
+  const size_t group_mask = control.size() / GROUP_WIDTH - 1;
+  size_t group = (hash >> 7) & group_mask;
+  for (size_t step = 1;; ++step) {
+    if (uint32_t mask = MatchFree(group)) {
+      return group * GROUP_WIDTH + __builtin_ctz(mask);
+    }
+    group = (group + step) & group_mask;
+  }
+}
+
+HashTable::HashTable()
+  : control(AccountedAllocator<int8_t>(MemoryAccount::Current()))
+  , slots(AccountedAllocator<uint32_t>(MemoryAccount::Current()))
+  , entries(AccountedAllocator<Entry>(MemoryAccount::Current()))
+{
+}
+
+ObjectHolder* HashTable::Find(const ObjectHolder& key) {
+  Slot slot = Locate(key, HashKey(key));
+  return slot.found ? &entries[slots[slot.position]].value : nullptr;
+}
+
+const ObjectHolder* HashTable::Find(const ObjectHolder& key) const {
+  Slot slot = Locate(key, HashKey(key));
+  return slot.found ? &entries[slots[slot.position]].value : nullptr;
+}
+
+void HashTable::Assign(const ObjectHolder& key, ObjectHolder value) {
+  const size_t hash = HashKey(key);
+  if (Slot slot = Locate(key, hash); slot.found) {
+    entries[slots[slot.position]].value = std::move(value);
+    return;
+  }
+
+  // Keep the load (including tombstones) under 7/8, and compact the entry
+  // array once erased entries make up a large part of it
+  if ((used_slots + 1) * 8 > control.size() * 7 || entries.size() >= control.size()) {
+    size_t capacity = GROUP_WIDTH;
+    while ((size + 1) * 8 > capacity * 7 / 2) {
+      capacity *= 2;
+    }
+    Rehash(capacity);
+  }
+
+  size_t position = FindInsertPosition(hash);
+  if (control[position] == EMPTY) {
+    ++used_slots;
+  }
+  control[position] = static_cast<int8_t>(hash & 0x7F);
+  slots[position] = static_cast<uint32_t>(entries.size());
+  entries.push_back({hash, key, std::move(value)});
+  ++size;
+}
+
+bool HashTable::Erase(const ObjectHolder& key) {
+  Slot slot = Locate(key, HashKey(key));
+  if (!slot.found) {
+    return false;
+  }
+  Entry& entry = entries[slots[slot.position]];
+  entry.key = ObjectHolder::None();
+  entry.value = ObjectHolder::None();
+  control[slot.position] = DELETED;
+  --size;
+  return true;
+}
+
+void HashTable::Rehash(size_t new_capacity) {
+  Array<Entry> live(entries.get_allocator());
+  live.reserve(size);
+  for (Entry& entry : entries) {
+    if (entry.key) {
+      live.push_back(std::move(entry));
+    }
+  }
+
+  control.assign(new_capacity, EMPTY);
+  slots.assign(new_capacity, 0);
+  entries = std::move(live);
+  used_slots = entries.size();
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    size_t position = FindInsertPosition(entries[i].hash);
+    control[position] = static_cast<int8_t>(entries[i].hash & 0x7F);
+    slots[position] = static_cast<uint32_t>(i);
+  }
+}
+
+} /* namespace Runtime */
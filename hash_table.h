@@ -0,0 +1,89 @@
+#pragma once
+
+#include "memory.h"
+#include "object_holder.h"
+
+#include <cstdint>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Hash of a dictionary key. Numbers that compare equal hash equally, strings
+// use their cached hash. Throws for values that cannot be keys.
+size_t HashKey(const ObjectHolder& key);
+
+// Open-addressing hash map from Mython values to Mython values in the style
+// of Swiss tables: a control byte per slot holds 7 bits of the hash, and a
+// whole group of 16 control bytes is matched at once (with SSE2 when
+// available). Slots refer into a dense entry array, which keeps iteration in
+// insertion order and cache-friendly. All three arrays are charged to the
+// memory account that was current when the table was created.
+class HashTable {
+public:
+  struct Entry {
+    size_t hash;
+    ObjectHolder key;
+    ObjectHolder value;
+  };
+
+  HashTable();
+
+  ObjectHolder* Find(const ObjectHolder& key);
+  const ObjectHolder* Find(const ObjectHolder& key) const;
+  void Assign(const ObjectHolder& key, ObjectHolder value);
+  bool Erase(const ObjectHolder& key);
+
+  size_t Size() const { return size; }
+
+  // Calls fn(entry) for each live entry in insertion order
+  template <typename F>
+  void ForEach(F fn) const {
+    for (const Entry& entry : entries) {
+      if (entry.key) {
+        fn(entry);
+      }
+    }
+  }
+
+  // Same, but fn may replace the values (never the keys)
+  template <typename F>
+  void ForEach(F fn) {
+    for (Entry& entry : entries) {
+      if (entry.key) {
+        fn(entry);
+      }
+    }
+  }
+
+private:
+  static constexpr size_t GROUP_WIDTH = 16;
+  static constexpr int8_t EMPTY = -128;
+  static constexpr int8_t DELETED = -2;
+
+  struct Slot {
+    size_t position;
+    bool found;
+  };
+
+  Slot Locate(const ObjectHolder& key, size_t hash) const;
+  size_t FindInsertPosition(size_t hash) const;
+  void Rehash(size_t new_capacity);
+
+  uint32_t MatchByte(size_t group, int8_t byte) const;
+  uint32_t MatchFree(size_t group) const;
+
+  template <typename T>
+  using Array = std::vector<T, AccountedAllocator<T>>;
+
+  Array<int8_t> control;
+  Array<uint32_t> slots;
+  Array<Entry> entries;
+  size_t size = 0;
+  size_t used_slots = 0;  // full and deleted control bytes
+};
+
+void RunHashTableTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,106 @@
+#include "hash_table.h"
+#include "object.h"
+
+#include "test_runner.h"
+
+#include <string>
+
+using namespace std;
+
+namespace Runtime {
+
+ObjectHolder Key(int64_t value) {
+  return ObjectHolder::Own(Number(value));
+}
+
+ObjectHolder Key(const string& value) {
+  return ObjectHolder::Own(String(value));
+}
+
+int64_t ValueOf(const ObjectHolder* value) {
+  return value->TryAs<Number>()->GetValue();
+}
+
+void TestHashTableFindAndAssign() {
+  HashTable table;
+  ASSERT(!table.Find(Key(1)));
+
+  table.Assign(Key(1), Key(10));
+  table.Assign(Key("one"), Key(100));
+  ASSERT_EQUAL(table.Size(), 2u);
+  ASSERT_EQUAL(ValueOf(table.Find(Key(1))), 10);
+  ASSERT_EQUAL(ValueOf(table.Find(Key("one"))), 100);
+  ASSERT(!table.Find(Key("two")));
+
+  table.Assign(Key(1), Key(11));
+  ASSERT_EQUAL(table.Size(), 2u);
+  ASSERT_EQUAL(ValueOf(table.Find(Key(1))), 11);
+}
+
+void TestHashTableErase() {
+  HashTable table;
+  table.Assign(Key("a"), Key(1));
+  table.Assign(Key("b"), Key(2));
+  table.Assign(Key("c"), Key(3));
+
+  ASSERT(table.Erase(Key("b")));
+  ASSERT(!table.Erase(Key("b")));
+  ASSERT_EQUAL(table.Size(), 2u);
+  ASSERT(!table.Find(Key("b")));
+
+  table.Assign(Key("b"), Key(4));
+  string order;
+  table.ForEach([&order](const HashTable::Entry& entry) {
+    order += entry.key.TryAs<String>()->GetValue();
+  });
+  ASSERT_EQUAL(order, "acb");
+}
+
+void TestHashTableGrowth() {
+  HashTable table;
+  const int64_t count = 10000;
+  for (int64_t i = 0; i < count; ++i) {
+    table.Assign(Key(i), Key(i * i));
+  }
+  for (int64_t i = 0; i < count; i += 2) {
+    ASSERT(table.Erase(Key(i)));
+  }
+  for (int64_t i = 0; i < count; ++i) {
+    table.Assign(Key(to_string(i)), Key(i));
+  }
+
+  ASSERT_EQUAL(table.Size(), static_cast<size_t>(count + count / 2));
+  for (int64_t i = 0; i < count; ++i) {
+    ASSERT_EQUAL(table.Find(Key(i)) != nullptr, i % 2 == 1);
+    ASSERT_EQUAL(ValueOf(table.Find(Key(to_string(i)))), i);
+  }
+  ASSERT_EQUAL(ValueOf(table.Find(Key(99))), 99 * 99);
+}
+
+void TestHashTableNumericKeys() {
+  HashTable table;
+  table.Assign(Key(2), Key(1));
+  table.Assign(ObjectHolder::Own(Float(2.0)), Key(2));
+  table.Assign(ObjectHolder::Own(Bool(true)), Key(3));
+  ASSERT_EQUAL(table.Size(), 2u);
+  ASSERT_EQUAL(ValueOf(table.Find(Key(2))), 2);
+  ASSERT_EQUAL(ValueOf(table.Find(ObjectHolder::Own(Bool(true)))), 3);
+  ASSERT(!table.Find(Key(1)));
+  ASSERT(!table.Find(ObjectHolder::Own(Float(2.5))));
+}
+
+void TestHashTableUnhashableKeys() {
+  HashTable table;
+  ASSERT_THROWS(table.Assign(ObjectHolder::Own(List()), Key(1)), runtime_error);
+  ASSERT_THROWS(table.Find(ObjectHolder::None()), runtime_error);
+}
+
+void RunHashTableTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestHashTableFindAndAssign);
+  RUN_TEST(tr, Runtime::TestHashTableErase);
+  RUN_TEST(tr, Runtime::TestHashTableGrowth);
+  RUN_TEST(tr, Runtime::TestHashTableNumericKeys);
+  RUN_TEST(tr, Runtime::TestHashTableUnhashableKeys);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,185 @@
+#include "interpreter.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace Runtime {
+
+namespace {
+thread_local Interpreter* current_interpreter = nullptr;
+}
+
+// Binds the interpreter to this thread and restores the previous binding
+// afterwards, so interpreters can also run nested (e.g. from a native method).
+// Scripts may call at most max_depth methods deeper than base_depth.
+class Interpreter::Activation {
+public:
+  Activation(Interpreter& interpreter, size_t base_depth)
+    : interpreter(interpreter)
+    , outer_interpreter(current_interpreter)
+    , outer_output(Ast::Print::GetOutputSink())
+    , outer_max_depth(CallStack::Current().MaxDepth())
+    , outer_memory(MemoryAccount::Bind(interpreter.memory.get()))
+  {
+    current_interpreter = &interpreter;
+    Ast::Print::SetOutputSink(interpreter.output);
+    std::swap(Ast::Print::PendingLine(), interpreter.pending_line);
+    CallStack::Current().SetMaxDepth(base_depth + interpreter.limits.max_depth);
+  }
+
+  Activation(const Activation&) = delete;
+  Activation& operator=(const Activation&) = delete;
+
+  ~Activation() {
+    CallStack::Current().SetMaxDepth(outer_max_depth);
+    std::swap(Ast::Print::PendingLine(), interpreter.pending_line);
+    Ast::Print::SetOutputSink(outer_output);
+    MemoryAccount::Bind(outer_memory);
+    current_interpreter = outer_interpreter;
+  }
+
+private:
+  Interpreter& interpreter;
+  Interpreter* outer_interpreter;
+  OutputSink& outer_output;
+  size_t outer_max_depth;
+  MemoryAccount* outer_memory;
+};
+
+Interpreter::Interpreter(OutputSink& output, Limits limits)
+  : output(output)
+  , limits(limits)
+  , memory(MemoryAccount::Create(limits.max_memory, limits.soft_memory))
+{
+}
+
+Interpreter::~Interpreter() = default;
+
+void Interpreter::Run(std::istream& input) {
+  Run(Program::Compile(input));
+}
+
+void Interpreter::Run(std::shared_ptr<const Program> program) {
+  programs.push_back(std::move(program));
+  const Program& image = *programs.back();
+  memory->ResetPeak();
+
+  Activation activation(*this, CallStack::Current().Depth());
+  try {
+    RunOnInterpreterStack([this, &image] { image.Execute(globals); });
+  } catch (...) {
+    output.Flush();
+    throw;
+  }
+  output.Flush();
+}
+
+Interpreter::Session::Session(Interpreter& interpreter)
+  : interpreter(interpreter)
+  , activation(std::make_unique<Activation>(interpreter, CallStack::Current().Depth()))
+  , outer_session(std::exchange(interpreter.session, this))
+  , outer_limit(CallStack::Current().NativeLimit())
+  , calls(&CallStack::Current())
+  , depth(CallStack::Current().Depth())
+{
+  if (!outer_limit) {
+    CallStack::Current().SetNativeLimit(ThreadStackLimit());
+  }
+}
+
+Interpreter::Session::~Session() {
+  CallStack::Current().SetNativeLimit(outer_limit);
+  interpreter.session = outer_session;
+}
+
+ObjectHolder Interpreter::Enter(ObjectHolder (*fn)(void*), void* context) {
+  CallStack& calls = CallStack::Current();
+  // Nothing has been bound since the session began: no script is running and
+  // no other interpreter has been entered
+  if (session && current_interpreter == this && session->calls == &calls && session->depth == calls.Depth()) {
+    return fn(context);
+  }
+  Activation activation(*this, calls.Depth());
+  // Already on an interpreter stack when a script calls back into a host
+  const char* outer_limit = calls.NativeLimit();
+  if (!outer_limit) {
+    calls.SetNativeLimit(ThreadStackLimit());
+  }
+  try {
+    ObjectHolder result = fn(context);
+    calls.SetNativeLimit(outer_limit);
+    return result;
+  } catch (...) {
+    calls.SetNativeLimit(outer_limit);
+    throw;
+  }
+}
+
+Interpreter* Interpreter::Current() {
+  return current_interpreter;
+}
+
+// Everything a task sees while it runs: its own call stack, its interpreter
+// and its step budget
+class Task::Binding {
+public:
+  Binding(Task& task, size_t steps)
+    : outer_calls(CallStack::Bind(&task.calls))
+    , activation(std::in_place, task.interpreter, 0)
+    , outer_steps(std::exchange(steps_left, steps))
+  {
+  }
+
+  Binding(const Binding&) = delete;
+  Binding& operator=(const Binding&) = delete;
+
+  ~Binding() {
+    steps_left = outer_steps;
+    // The activation must still see the task's call stack
+    activation.reset();
+    CallStack::Bind(outer_calls);
+  }
+
+private:
+  CallStack* outer_calls;
+  std::optional<Interpreter::Activation> activation;
+  size_t outer_steps;
+};
+
+Task::Task(Interpreter& interpreter, std::shared_ptr<const Program> program)
+  : interpreter(interpreter)
+  , stack(
+      [&globals = interpreter.globals, &image = *program] { image.Execute(globals); },
+      interpreter.limits.max_depth, true)
+{
+  interpreter.programs.push_back(std::move(program));
+  interpreter.memory->ResetPeak();
+}
+
+Task::~Task() {
+  // Unwind inside the binding, so a half-printed line goes to the task's output
+  Binding binding(*this, SIZE_MAX);
+  stack.Cancel();
+}
+
+bool Task::Resume(size_t steps) {
+  bool done = false;
+  {
+    Binding binding(*this, std::max<size_t>(steps, 1));
+    try {
+      done = stack.Resume();
+    } catch (...) {
+      interpreter.output.Flush();
+      throw;
+    }
+  }
+  if (done) {
+    interpreter.output.Flush();
+  }
+  return done;
+}
+
+} /* namespace Runtime */
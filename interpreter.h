@@ -0,0 +1,137 @@
+#pragma once
+
+#include "call_stack.h"
+#include "memory.h"
+#include "object.h"
+#include "output_sink.h"
+#include "program.h"
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Memory limits are in bytes, 0 meaning unlimited. Past max_memory the script
+// fails with MemoryError; crossing soft_memory calls the pressure callback.
+struct Limits {
+  size_t max_depth = CallStack::DEFAULT_MAX_DEPTH;
+  size_t max_memory = 0;
+  size_t soft_memory = 0;
+};
+
+// Everything one script run owns: its output, its global variables and its
+// limits. Interpreters share no mutable state, so independent ones may run on
+// different threads at the same time. While Run executes, the interpreter is
+// bound to the calling thread and Current() returns it.
+class Interpreter {
+  class Activation;
+
+public:
+  explicit Interpreter(OutputSink& output, Limits limits = {});
+  Interpreter(const Interpreter&) = delete;
+  Interpreter& operator=(const Interpreter&) = delete;
+  ~Interpreter();
+
+  // Executes the program on the interpreter stack, then flushes the output.
+  // Globals persist from one run to the next. Memory().Peak() is the peak
+  // usage of the last run.
+  void Run(std::shared_ptr<const Program> program);
+  void Run(std::istream& program);
+  // Runs fn() with the interpreter bound, as Run does, but on the calling
+  // thread's own stack and without flushing the output: for hosts calling
+  // into objects of the scripts, many times over (see Module)
+  template <typename F>
+  ObjectHolder Enter(F&& fn) {
+    // fn is called before Enter returns, so it is passed by address rather
+    // than copied into a std::function
+    return Enter([](void* context) { return (*static_cast<std::remove_reference_t<F>*>(context))(); }, &fn);
+  }
+
+  // Keeps the interpreter bound to the calling thread for as long as it
+  // exists. Enter called straight from the host under a session, rather than
+  // from a script, then calls fn without binding the interpreter again: for
+  // hosts making many short calls in a row. Sessions nest, and a session must
+  // end on the thread and in the reverse order it began.
+  class Session {
+  public:
+    explicit Session(Interpreter& interpreter);
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    ~Session();
+
+  private:
+    friend class Interpreter;
+
+    Interpreter& interpreter;
+    std::unique_ptr<Activation> activation;
+    Session* outer_session;
+    const char* outer_limit;
+    // Where the host stands; a script running under the session is deeper
+    const CallStack* calls;
+    size_t depth;
+  };
+
+  OutputSink& Output() { return output; }
+  // Source of the input() builtin; none by default
+  std::istream* Input() { return input; }
+  void SetInput(std::istream& input_stream) { input = &input_stream; }
+  Closure& Globals() { return globals; }
+  const Limits& GetLimits() const { return limits; }
+  // Objects the scripts of this interpreter have created and not yet freed
+  MemoryAccount& Memory() { return *memory; }
+
+  static Interpreter* Current();
+
+private:
+  friend class Task;
+  friend class Snapshot;
+
+  ObjectHolder Enter(ObjectHolder (*fn)(void*), void* context);
+
+  OutputSink& output;
+  std::istream* input = nullptr;
+  Limits limits;
+  // Declared before the globals so that it is released after them
+  MemoryAccount::Handle memory;
+  Closure globals;
+  // Print output of a suspended task that has not made a full line yet
+  std::string pending_line;
+  // Globals may refer to classes and literals of any program run so far
+  std::vector<std::shared_ptr<const Program>> programs;
+  Session* session = nullptr;
+};
+
+// A run of a program that gives up the thread after a given number of steps
+// (statements and method calls) and continues where it stopped on the next
+// Resume, so a runaway script cannot hold on to its thread. A task has its own
+// call stack and native stack; it must be resumed on the thread that started
+// it, and its interpreter must not run anything else until the task is done.
+// Destroying an unfinished task unwinds the script.
+class Task {
+public:
+  Task(Interpreter& interpreter, std::shared_ptr<const Program> program);
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task();
+
+  // Runs at most steps steps. Returns true once the program has finished and
+  // rethrows the error it failed with.
+  bool Resume(size_t steps);
+  bool Done() const { return stack.Done(); }
+
+private:
+  class Binding;
+
+  Interpreter& interpreter;
+  CallStack calls;
+  InterpreterStack stack;
+};
+
+void RunInterpreterTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,171 @@
+#include "interpreter.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Runtime {
+
+void TestInterpreterGlobals() {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+
+  istringstream first("x = 40\nclass Box:\n  def __init__(v):\n    self.v = v\nb = Box(2)\n");
+  interpreter.Run(first);
+  istringstream second("print x + b.v\n");
+  interpreter.Run(second);
+
+  ASSERT_EQUAL(os.str(), "42\n");
+  ASSERT(interpreter.Globals().count("x"));
+  ASSERT(Interpreter::Current() == nullptr);
+}
+
+void TestInterpreterRestoresThreadState() {
+  ostringstream outer;
+  Ast::Print::SetOutputStream(outer);
+  Runtime::OutputSink& outer_sink = Ast::Print::GetOutputSink();
+
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink, Limits{50});
+  istringstream program(R"(
+class Deep:
+  def down(n):
+    if n == 0:
+      return 0
+    return 1 + self.down(n - 1)
+
+deep = Deep()
+print deep.down(40)
+print deep.down(60)
+)");
+  ASSERT_THROWS(interpreter.Run(program), RecursionError);
+
+  ASSERT_EQUAL(os.str(), "40\n");
+  ASSERT(&Ast::Print::GetOutputSink() == &outer_sink);
+  ASSERT_EQUAL(CallStack::Current().MaxDepth(), CallStack::DEFAULT_MAX_DEPTH);
+  ASSERT_EQUAL(outer.str(), "");
+}
+
+void TestInterpretersInParallel() {
+  const int thread_count = 4;
+  const string program = R"(
+class Counter:
+  def count(name, n):
+    for i in range(n):
+      print name, i
+)";
+
+  vector<ostringstream> outputs(thread_count);
+  vector<thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&outputs, &program, t] {
+      StreamSink sink(outputs[t]);
+      Interpreter interpreter(sink);
+      istringstream input(program + "c = Counter()\nc.count('t" + to_string(t) + "', 2000)\n");
+      interpreter.Run(input);
+    });
+  }
+  for (thread& worker : threads) {
+    worker.join();
+  }
+
+  for (int t = 0; t < thread_count; ++t) {
+    string expected;
+    for (int i = 0; i < 2000; ++i) {
+      expected += "t" + to_string(t) + " " + to_string(i) + "\n";
+    }
+    ASSERT_EQUAL(outputs[t].str(), expected);
+  }
+}
+
+void TestSharedProgram() {
+  istringstream source(R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+
+total = 0.5
+for i in range(1000):
+  total = total * 1.0 + 1.5
+print Point(total, 'p'), total + 0.5
+)");
+  const shared_ptr<const Program> program = Program::Compile(source);
+
+  const int thread_count = 4;
+  vector<ostringstream> outputs(thread_count);
+  vector<thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&outputs, &program, t] {
+      StreamSink sink(outputs[t]);
+      Interpreter interpreter(sink);
+      for (int run = 0; run < 20; ++run) {
+        interpreter.Run(program);
+      }
+    });
+  }
+  for (thread& worker : threads) {
+    worker.join();
+  }
+
+  string expected;
+  for (int run = 0; run < 20; ++run) {
+    expected += "(1500.5, p) 1501.0\n";
+  }
+  for (int t = 0; t < thread_count; ++t) {
+    ASSERT_EQUAL(outputs[t].str(), expected);
+  }
+}
+
+void TestDeepObjectGraphs() {
+  ostringstream os;
+  StreamSink sink(os);
+  {
+    Interpreter interpreter(sink, Limits{100});
+    istringstream build(R"(
+class Node:
+  def __init__(next):
+    self.next = next
+
+chain = None
+for i in range(1000000):
+  chain = Node(chain)
+nested = []
+for i in range(1000000):
+  nested = [nested, {'inner': [nested]}]
+)");
+    interpreter.Run(build);
+    // Printing nests one C++ call per level and runs out of native stack
+    // long before the bottom
+    istringstream print("print nested\n");
+    ASSERT_THROWS(interpreter.Run(print), RecursionError);
+    istringstream compare("print nested == [nested]\n");
+    ASSERT_THROWS(interpreter.Run(compare), RecursionError);
+    // One chain is dropped here, the other with the rest of the globals
+    istringstream drop("chain = None\n");
+    interpreter.Run(drop);
+  }
+  // Only the beginning of the list that could not be printed
+  ASSERT_EQUAL(os.str().find_first_not_of('['), string::npos);
+}
+
+void RunInterpreterTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestInterpreterGlobals);
+  RUN_TEST(tr, Runtime::TestInterpreterRestoresThreadState);
+  RUN_TEST(tr, Runtime::TestInterpretersInParallel);
+  RUN_TEST(tr, Runtime::TestSharedProgram);
+  RUN_TEST(tr, Runtime::TestDeepObjectGraphs);
+}
+
+} /* namespace Runtime */
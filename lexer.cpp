@@ -17,6 +17,10 @@ bool operator == (const Token& lhs, const Token& rhs) {
     return lhs.As<Char>().value == rhs.As<Char>().value;
   } else if (lhs.Is<Number>()) {
     return lhs.As<Number>().value == rhs.As<Number>().value;
+  } else if (lhs.Is<Float>()) {
+    return lhs.As<Float>().value == rhs.As<Float>().value;
+  } else if (lhs.Is<LongNumber>()) {
+    return lhs.As<LongNumber>().value == rhs.As<LongNumber>().value;
   } else if (lhs.Is<String>()) {
     return lhs.As<String>().value == rhs.As<String>().value;
   } else if (lhs.Is<Id>()) {
@@ -33,6 +37,8 @@ std::ostream& operator << (std::ostream& os, const Token& rhs) {
   if (auto p = rhs.TryAs<type>()) return os << #type << '{' << p->value << '}';
 
   VALUED_OUTPUT(Number);
+  VALUED_OUTPUT(LongNumber);
+  VALUED_OUTPUT(Float);
   VALUED_OUTPUT(Id);
   VALUED_OUTPUT(String);
   VALUED_OUTPUT(Char);
@@ -61,6 +67,12 @@ std::ostream& operator << (std::ostream& os, const Token& rhs) {
   UNVALUED_OUTPUT(None);
   UNVALUED_OUTPUT(True);
   UNVALUED_OUTPUT(False);
+  UNVALUED_OUTPUT(In);
+  UNVALUED_OUTPUT(Del);
+  UNVALUED_OUTPUT(While);
+  UNVALUED_OUTPUT(For);
+  UNVALUED_OUTPUT(Break);
+  UNVALUED_OUTPUT(Continue);
   UNVALUED_OUTPUT(Eof);
 
 #undef UNVALUED_OUTPUT
@@ -69,9 +81,28 @@ std::ostream& operator << (std::ostream& os, const Token& rhs) {
 }
 
 Lexer::Lexer(std::istream& input) : stream(input) { current_token = NextToken(); };
+
+namespace {
+// Never read: a replaying lexer has no source text
+std::istream& NoInput() {
+  static std::istringstream empty;
+  return empty;
+}
+}
+
+Lexer::Lexer(std::vector<Token> tokens)
+  : stream(NoInput()), replaying(true), replay(std::move(tokens))
+{
+  current_token = NextToken();
+}
+
 const Token& Lexer::CurrentToken() const { return current_token; }
 
 Token Lexer::NextToken() {
+  if (replaying) {
+    current_token = replay_position < replay.size() ? replay[replay_position++] : Token(TokenType::Eof());
+    return current_token;
+  }
   current_token = ReadStream();
   return current_token;
 }
@@ -161,10 +192,23 @@ Token Lexer::HandleNewline(std::istream& stream) {
 }
 
 Token Lexer::CreateNumberToken(const std::string& text) {
-  int n = stoi(text);
+  int64_t n = 0;
+  auto [end, ec] = from_chars(text.data(), text.data() + text.size(), n);
+  if (ec == errc::result_out_of_range) {
+    return Token(TokenType::LongNumber{text});
+  }
   return Token(TokenType::Number{n});
 }
 
+Token Lexer::CreateFloatToken(const std::string& text) {
+  double value = 0;
+  auto [end, ec] = from_chars(text.data(), text.data() + text.size(), value);
+  if (ec == errc::result_out_of_range) {
+    throw LexerError("float literal out of range: " + text);
+  }
+  return Token(TokenType::Float{value});
+}
+
 Token Lexer::ReadStream() {
 
   if (stream.peek() == EOF) { return HandleEof(stream); }
@@ -208,7 +252,26 @@ Token Lexer::ReadStream() {
 
   if (isdigit(stream.peek())) {
     string digits = CollectDigits(stream);
-    return CreateNumberToken(digits);
+    bool is_float = false;
+    if (stream.peek() == '.') {
+      digits.push_back(stream.get());
+      digits += CollectDigits(stream);
+      is_float = true;
+    }
+    // An exponent, as in 1e300 or 1.5E-7, which is how large and small
+    // floats are printed
+    if (stream.peek() == 'e' || stream.peek() == 'E') {
+      digits.push_back(stream.get());
+      if (stream.peek() == '+' || stream.peek() == '-') {
+        digits.push_back(stream.get());
+      }
+      if (!isdigit(stream.peek())) {
+        throw LexerError("exponent without digits in " + digits);
+      }
+      digits += CollectDigits(stream);
+      is_float = true;
+    }
+    return is_float ? CreateFloatToken(digits) : CreateNumberToken(digits);
   }
 
   if (isalnum(stream.peek()) || stream.peek() == '_') {
@@ -224,4 +287,4 @@ Token Lexer::ReadStream() {
   return Token(TokenType::Eof{});
 }
 
-} /* namespace Parse */
\ No newline at end of file
+} /* namespace Parse */
\ No newline at end of file
@@ -10,11 +10,15 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <cctype>
+#include <cstdint>
+#include <vector>
 
 namespace Parse {
 
 namespace TokenType {
-  struct Number { int value; };
+  struct Number { int64_t value; };
+  struct LongNumber { std::string value; };
+  struct Float { double value; };
   struct Id { std::string value; };
   struct Char { char value; };
   struct String { std::string value;};
@@ -38,6 +42,12 @@ namespace TokenType {
   struct None {};
   struct True {};
   struct False {};
+  struct In {};
+  struct Del {};
+  struct While {};
+  struct For {};
+  struct Break {};
+  struct Continue {};
 }
 
 using TokenBase = std::variant<
@@ -64,7 +74,15 @@ using TokenBase = std::variant<
   TokenType::None,//20
   TokenType::True,//21
   TokenType::False,//22
-  TokenType::Eof//23
+  TokenType::LongNumber,//23
+  TokenType::Float,//24
+  TokenType::In,//25
+  TokenType::Del,//26
+  TokenType::While,//27
+  TokenType::For,//28
+  TokenType::Break,//29
+  TokenType::Continue,//30
+  TokenType::Eof//31
 >;
 
 struct Token : TokenBase {
@@ -92,6 +110,9 @@ public:
 class Lexer {
 public:
   explicit Lexer(std::istream& input);
+  // Replays tokens lexed before (e.g. read from a program cache); the last
+  // one should be Eof
+  explicit Lexer(std::vector<Token> tokens);
   
   const Token& CurrentToken() const;
   Token NextToken();
@@ -125,6 +146,7 @@ public:
   }
   
   Token CreateNumberToken(const std::string& text);
+  Token CreateFloatToken(const std::string& text);
   Token CreateToken(const std::string& text);
   Token GetKeywordToken(const std::string& text);
   Token CreateTokenFromPunct(std::istream& stream);
@@ -141,6 +163,9 @@ public:
 private:
   std::istream& stream;
   Token current_token{TokenType::Eof()};
+  bool replaying = false;
+  std::vector<Token> replay;
+  size_t replay_position = 0;
   int current_indent = 0;
   int count_spaces = 0;
   using TokenMapping = std::unordered_map<std::string, Token>;
@@ -156,6 +181,12 @@ private:
                           {"True", Token(TokenType::True())},
                           {"False", Token(TokenType::False())},
                           {"not", Token(TokenType::Not())},
+                          {"in", Token(TokenType::In())},
+                          {"del", Token(TokenType::Del())},
+                          {"while", Token(TokenType::While())},
+                          {"for", Token(TokenType::For())},
+                          {"break", Token(TokenType::Break())},
+                          {"continue", Token(TokenType::Continue())},
                           {"==", Token(TokenType::Eq())},
                           {"!=", Token(TokenType::NotEq())},
                           {">=", Token(TokenType::GreaterOrEq())},
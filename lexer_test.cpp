@@ -50,6 +50,42 @@ void TestNumbers() {
   ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Number{53}));
 }
 
+void TestLongNumbers() {
+  istringstream input("9223372036854775807 9223372036854775808 123456789012345678901234567890");
+  Lexer lexer(input);
+
+  ASSERT_EQUAL(lexer.CurrentToken(), Token(TokenType::Number{INT64_MAX}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::LongNumber{"9223372036854775808"}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::LongNumber{"123456789012345678901234567890"}));
+}
+
+void TestFloats() {
+  istringstream input("3.25 0.5 7. 12");
+  Lexer lexer(input);
+
+  ASSERT_EQUAL(lexer.CurrentToken(), Token(TokenType::Float{3.25}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Float{0.5}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Float{7.0}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Number{12}));
+}
+
+void TestFloatExponents() {
+  istringstream input("1e300 1.5E-7 2.e+3 1.2345678901234568e+29 4E0");
+  Lexer lexer(input);
+
+  ASSERT_EQUAL(lexer.CurrentToken(), Token(TokenType::Float{1e300}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Float{1.5e-7}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Float{2000.0}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Float{1.2345678901234568e+29}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Float{4.0}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Newline{}));
+
+  for (const char* malformed : {"1e", "2.5e+", "3Ex", "1e400"}) {
+    istringstream bad(malformed);
+    ASSERT_THROWS(Lexer{bad}, LexerError);
+  }
+}
+
 void TestIds() {
   istringstream input("x    _42 big_number   Return Class  dEf");
   Lexer lexer(input);
@@ -322,6 +358,9 @@ void RunLexerTests(TestRunner& tr) {
   RUN_TEST(tr, Parse::TestSimpleAssignment);
   RUN_TEST(tr, Parse::TestKeywords);
   RUN_TEST(tr, Parse::TestNumbers);
+  RUN_TEST(tr, Parse::TestLongNumbers);
+  RUN_TEST(tr, Parse::TestFloats);
+  RUN_TEST(tr, Parse::TestFloatExponents);
   RUN_TEST(tr, Parse::TestIds);
   RUN_TEST(tr, Parse::TestStrings);
   RUN_TEST(tr, Parse::TestOperations);
@@ -0,0 +1,45 @@
+#include "memory.h"
+
+#include <string>
+#include <utility>
+
+namespace Runtime {
+
+MemoryAccount::Handle MemoryAccount::Create(size_t hard_limit, size_t soft_limit) {
+  return Handle(new MemoryAccount(hard_limit, soft_limit));
+}
+
+MemoryAccount* MemoryAccount::Bind(MemoryAccount* account) {
+  return std::exchange(current, account);
+}
+
+void MemoryAccount::OnPeak(size_t used, size_t bytes) {
+  if (hard_limit && used > hard_limit) {
+    balance.fetch_sub(bytes, std::memory_order_relaxed);
+    throw MemoryError(
+      "memory limit of " + std::to_string(hard_limit) + " bytes exceeded"
+    );
+  }
+  if (used > peak) {
+    peak = used;
+  }
+  if (soft_limit && used > soft_limit && !above_soft_limit) {
+    above_soft_limit = true;
+    if (on_pressure) {
+      on_pressure(used);
+    }
+  }
+}
+
+void MemoryAccount::ResetPeak() {
+  peak = Used();
+  above_soft_limit = soft_limit && peak > soft_limit;
+}
+
+void MemoryAccount::Release() {
+  if (balance.fetch_sub(OWNER_BIAS, std::memory_order_acq_rel) == OWNER_BIAS) {
+    delete this;
+  }
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Raised when a script needs more memory than its interpreter allows
+class MemoryError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// Bytes held by the objects of one interpreter. Objects are charged on the
+// thread their interpreter runs on and credited wherever they die. The account
+// outlives its owner for as long as any of its objects does.
+class MemoryAccount {
+public:
+  // Called from the allocation that crossed the soft limit; it fires again
+  // only after ResetPeak finds the usage back under the limit
+  using PressureCallback = std::function<void(size_t used)>;
+
+  // Released by the owner instead of deleted
+  struct Releaser {
+    void operator()(MemoryAccount* account) const { account->Release(); }
+  };
+  using Handle = std::unique_ptr<MemoryAccount, Releaser>;
+
+  // Limits of 0 mean unlimited
+  static Handle Create(size_t hard_limit = 0, size_t soft_limit = 0);
+
+  // The account charged for objects created on this thread, if any
+  static MemoryAccount* Current() { return current; }
+  static MemoryAccount* Bind(MemoryAccount* account);
+
+  // Throws MemoryError, and charges nothing, past the hard limit
+  void Charge(size_t bytes) {
+    const size_t used = balance.fetch_add(bytes, std::memory_order_relaxed) + bytes - OWNER_BIAS;
+    // Neither limit can be crossed without setting a new peak
+    if (used > peak) {
+      OnPeak(used, bytes);
+    }
+  }
+  void Credit(size_t bytes) {
+    if (balance.fetch_sub(bytes, std::memory_order_acq_rel) == bytes) {
+      delete this;
+    }
+  }
+
+  size_t Used() const { return balance.load(std::memory_order_relaxed) - OWNER_BIAS; }
+  size_t Peak() const { return peak; }
+  void ResetPeak();
+
+  void SetPressureCallback(PressureCallback callback) { on_pressure = std::move(callback); }
+
+private:
+  // Held in the balance for as long as the owner keeps the account, so that
+  // one atomic counts both the bytes and whether anyone still needs it
+  static constexpr size_t OWNER_BIAS = size_t(1) << 62;
+
+  MemoryAccount(size_t hard_limit, size_t soft_limit)
+    : hard_limit(hard_limit), soft_limit(soft_limit) {}
+  void Release();
+  void OnPeak(size_t used, size_t bytes);
+
+  static inline thread_local MemoryAccount* current = nullptr;
+
+  std::atomic<size_t> balance{OWNER_BIAS};
+  // Only charges move these, and those happen on the owner's thread
+  size_t peak = 0;
+  size_t hard_limit;
+  size_t soft_limit;
+  bool above_soft_limit = false;
+  PressureCallback on_pressure;
+};
+
+// Blocks of up to MAX_SIZE bytes freed on this thread, kept to be handed out
+// again before asking the heap: arithmetic frees one number and allocates
+// another for nearly every operation. A block may be freed on another thread
+// than the one that allocated it. The blocks still kept when a thread exits
+// go back to the heap.
+class BlockCache {
+public:
+  static constexpr size_t MAX_SIZE = 128;
+
+  static void* Allocate(size_t size) {
+    Lists& lists = ThreadLists();
+    const size_t index = IndexOf(size);
+    if (FreeBlock* block = lists.heads[index]) {
+      lists.heads[index] = block->next;
+      --lists.counts[index];
+      return block;
+    }
+    return ::operator new(RoundedUp(size));
+  }
+
+  static void Free(void* pointer, size_t size) {
+    Lists& lists = ThreadLists();
+    const size_t index = IndexOf(size);
+    if (lists.counts[index] == MAX_BLOCKS_PER_SIZE) {
+      ::operator delete(pointer);
+      return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = lists.heads[index];
+    lists.heads[index] = block;
+    ++lists.counts[index];
+  }
+
+private:
+  static constexpr size_t GRANULE = 16;
+  static constexpr size_t MAX_BLOCKS_PER_SIZE = 64;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct Lists {
+    FreeBlock* heads[MAX_SIZE / GRANULE] = {};
+    size_t counts[MAX_SIZE / GRANULE] = {};
+
+    ~Lists() {
+      for (FreeBlock* head : heads) {
+        while (head) {
+          ::operator delete(std::exchange(head, head->next));
+        }
+      }
+    }
+  };
+
+  static size_t IndexOf(size_t size) { return (size - 1) / GRANULE; }
+  static size_t RoundedUp(size_t size) { return (IndexOf(size) + 1) * GRANULE; }
+
+  static Lists& ThreadLists() {
+    static thread_local Lists lists;
+    return lists;
+  }
+};
+
+// Charges the account that was current when the allocator was made. A shared
+// object keeps a copy in its control block, so it is credited to the same
+// account on whichever thread it is freed.
+template <typename T>
+class AccountedAllocator {
+public:
+  using value_type = T;
+
+  explicit AccountedAllocator(MemoryAccount* account, size_t extra = 0)
+    : account(account), extra(extra) {}
+
+  template <typename U>
+  AccountedAllocator(const AccountedAllocator<U>& other)
+    : account(other.account), extra(other.extra) {}
+
+  T* allocate(size_t n) {
+    if (account) {
+      account->Charge(n * sizeof(T) + extra);
+    }
+    try {
+      if (IsSmall(n)) {
+        return static_cast<T*>(BlockCache::Allocate(n * sizeof(T)));
+      }
+      return std::allocator<T>().allocate(n);
+    } catch (...) {
+      if (account) {
+        account->Credit(n * sizeof(T) + extra);
+      }
+      throw;
+    }
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (IsSmall(n)) {
+      BlockCache::Free(p, n * sizeof(T));
+    } else {
+      std::allocator<T>().deallocate(p, n);
+    }
+    if (account) {
+      account->Credit(n * sizeof(T) + extra);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const AccountedAllocator<U>& other) const { return account == other.account; }
+  template <typename U>
+  bool operator!=(const AccountedAllocator<U>& other) const { return account != other.account; }
+
+private:
+  template <typename U>
+  friend class AccountedAllocator;
+
+  static bool IsSmall(size_t n) {
+    return alignof(T) <= alignof(std::max_align_t) && n * sizeof(T) <= BlockCache::MAX_SIZE;
+  }
+
+  MemoryAccount* account;
+  // Heap bytes the object owns besides itself (e.g. the characters of a
+  // string), charged together with it
+  size_t extra;
+};
+
+// Memory an object grows into after it was created and charged, such as the
+// larger buffer of a list that is appended to. Charged to the account current
+// when the object first grows, and credited to the same account when the
+// object dies. A copy of an object has not grown yet.
+class GrowthCharge {
+public:
+  GrowthCharge() = default;
+  GrowthCharge(const GrowthCharge&) {}
+  GrowthCharge(GrowthCharge&& other) noexcept
+    : account(other.account), bytes(std::exchange(other.bytes, 0)) {}
+  GrowthCharge& operator=(const GrowthCharge&) = delete;
+  ~GrowthCharge() {
+    if (bytes > 0) {
+      account->Credit(bytes);
+    }
+  }
+
+  // Throws MemoryError, and charges nothing, past the hard limit
+  void Add(size_t more) {
+    if (!account && !(account = MemoryAccount::Current())) {
+      return;
+    }
+    account->Charge(more);
+    bytes += more;
+  }
+
+private:
+  MemoryAccount* account = nullptr;
+  size_t bytes = 0;
+};
+
+void RunMemoryTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,152 @@
+#include "memory.h"
+#include "interpreter.h"
+#include "object.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Runtime {
+
+void TestMemoryAccountLimits() {
+  auto account = MemoryAccount::Create(100, 50);
+  size_t pressure = 0;
+  account->SetPressureCallback([&pressure](size_t used) { pressure = used; });
+
+  account->Charge(40);
+  ASSERT_EQUAL(pressure, 0u);
+  account->Charge(20);
+  ASSERT_EQUAL(pressure, 60u);
+  ASSERT_THROWS(account->Charge(50), MemoryError);
+  ASSERT_EQUAL(account->Used(), 60u);
+  account->Charge(10);
+  ASSERT_EQUAL(pressure, 60u);
+
+  account->Credit(70);
+  ASSERT_EQUAL(account->Used(), 0u);
+  ASSERT_EQUAL(account->Peak(), 70u);
+  account->ResetPeak();
+  ASSERT_EQUAL(account->Peak(), 0u);
+}
+
+void TestObjectsChargeTheBoundAccount() {
+  auto account = MemoryAccount::Create();
+  ObjectHolder outside = ObjectHolder::Own(Number(1));
+
+  MemoryAccount* outer = MemoryAccount::Bind(account.get());
+  ObjectHolder number = ObjectHolder::Own(Number(2));
+  const size_t after_number = account->Used();
+  ASSERT(after_number >= sizeof(Number));
+  ObjectHolder text = ObjectHolder::Own(String(string(1000, 'x')));
+  ASSERT(account->Used() >= after_number + sizeof(String) + 1000);
+  MemoryAccount::Bind(outer);
+
+  number = ObjectHolder::None();
+  text = ObjectHolder::None();
+  ASSERT_EQUAL(account->Used(), 0u);
+  outside = ObjectHolder::None();
+}
+
+void TestAccountOutlivesItsOwner() {
+  ObjectHolder survivor;
+  {
+    auto account = MemoryAccount::Create();
+    MemoryAccount* outer = MemoryAccount::Bind(account.get());
+    survivor = ObjectHolder::Own(String(string(100, 'y')));
+    MemoryAccount::Bind(outer);
+  }
+  // Freed after the account's owner has let go of it
+  ASSERT_EQUAL(survivor.TryAs<String>()->GetValue().size(), 100u);
+  survivor = ObjectHolder::None();
+}
+
+void TestInterpreterMemoryLimit() {
+  ostringstream os;
+  StreamSink sink(os);
+  Limits limits;
+  limits.max_memory = 1 << 20;
+  limits.soft_memory = 1 << 18;
+  Interpreter interpreter(sink, limits);
+  size_t pressure = 0;
+  interpreter.Memory().SetPressureCallback([&pressure](size_t used) { pressure = used; });
+
+  istringstream program(R"(
+s = 'abcdefghijklmnopqrstuvwxyz'
+while True:
+  s = s + s
+)");
+  ASSERT_THROWS(interpreter.Run(program), MemoryError);
+  ASSERT(pressure > limits.soft_memory);
+  ASSERT(interpreter.Memory().Peak() <= limits.max_memory);
+  ASSERT(interpreter.Memory().Peak() > limits.max_memory / 4);
+  ASSERT(MemoryAccount::Current() == nullptr);
+}
+
+void TestContainerGrowthIsCharged() {
+  ostringstream os;
+  StreamSink sink(os);
+  Limits limits;
+  limits.max_memory = 1 << 20;
+  Interpreter interpreter(sink, limits);
+
+  // Only the list's buffer grows: the item is one shared object
+  istringstream append(R"(
+item = 'shared'
+items = []
+while True:
+  items.append(item)
+)");
+  ASSERT_THROWS(interpreter.Run(append), MemoryError);
+  ASSERT(interpreter.Memory().Peak() <= limits.max_memory);
+  ASSERT(interpreter.Memory().Peak() > limits.max_memory / 4);
+
+  istringstream release("items = None\n");
+  interpreter.Run(release);
+  const size_t before = interpreter.Memory().Used();
+  istringstream assign(R"(
+table = {}
+for i in range(1000):
+  table[i] = None
+)");
+  interpreter.Run(assign);
+  ASSERT(interpreter.Memory().Used() - before >= 1000 * (sizeof(HashTable::Entry) + sizeof(Number)));
+  istringstream drop("table = None\ni = None\n");
+  interpreter.Run(drop);
+  ASSERT_EQUAL(interpreter.Memory().Used(), before);
+}
+
+void TestPeakOfEachRun() {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+
+  istringstream first(R"(
+items = []
+for i in range(1000):
+  items.append(i)
+items = None
+)");
+  interpreter.Run(first);
+  const size_t first_peak = interpreter.Memory().Peak();
+  ASSERT(first_peak >= 1000 * sizeof(Number));
+  ASSERT(interpreter.Memory().Used() < first_peak / 10);
+
+  istringstream second("print 'small'\n");
+  interpreter.Run(second);
+  ASSERT(interpreter.Memory().Peak() < first_peak / 10);
+  ASSERT_EQUAL(os.str(), "small\n");
+}
+
+void RunMemoryTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestMemoryAccountLimits);
+  RUN_TEST(tr, Runtime::TestObjectsChargeTheBoundAccount);
+  RUN_TEST(tr, Runtime::TestAccountOutlivesItsOwner);
+  RUN_TEST(tr, Runtime::TestInterpreterMemoryLimit);
+  RUN_TEST(tr, Runtime::TestContainerGrowthIsCharged);
+  RUN_TEST(tr, Runtime::TestPeakOfEachRun);
+}
+
+} /* namespace Runtime */
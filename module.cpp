@@ -0,0 +1,150 @@
+#include "module.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace Runtime {
+
+ObjectHolder ToObject(int64_t value) {
+  return ObjectHolder::Own(Number(value));
+}
+
+ObjectHolder ToObject(int value) {
+  return ToObject(static_cast<int64_t>(value));
+}
+
+ObjectHolder ToObject(double value) {
+  return ObjectHolder::Own(Float(value));
+}
+
+ObjectHolder ToObject(bool value) {
+  return ObjectHolder::Own(Bool(value));
+}
+
+ObjectHolder ToObject(string value) {
+  return ObjectHolder::Own(String(std::move(value)));
+}
+
+ObjectHolder ToObject(const char* value) {
+  return ToObject(string(value));
+}
+
+template <>
+int64_t FromObject<int64_t>(const ObjectHolder& object) {
+  if (KindOf(object) != ObjectKind::Number) {
+    throw runtime_error("expected an integer that fits in 64 bits");
+  }
+  return static_cast<const Number&>(*object).GetValue();
+}
+
+template <>
+double FromObject<double>(const ObjectHolder& object) {
+  switch (KindOf(object)) {
+  case ObjectKind::Float:
+    return static_cast<const Float&>(*object).GetValue();
+  case ObjectKind::Number:
+    return static_cast<double>(static_cast<const Number&>(*object).GetValue());
+  default:
+    throw runtime_error("expected a number");
+  }
+}
+
+template <>
+bool FromObject<bool>(const ObjectHolder& object) {
+  return IsTrue(object);
+}
+
+template <>
+string FromObject<string>(const ObjectHolder& object) {
+  if (KindOf(object) != ObjectKind::String) {
+    throw runtime_error("expected a string");
+  }
+  return static_cast<const String&>(*object).GetValue();
+}
+
+namespace {
+
+ClassInstance& AsInstance(const ObjectHolder& object) {
+  if (KindOf(object) != ObjectKind::Instance) {
+    throw runtime_error("methods can only be called on class instances");
+  }
+  // The holder is const, the object it refers to is not
+  return const_cast<ClassInstance&>(static_cast<const ClassInstance&>(*object));
+}
+
+}
+
+ObjectHolder MethodHandle::operator()(const ObjectHolder& instance, const vector<ObjectHolder>& args) const {
+  ClassInstance& self = AsInstance(instance);
+  return interpreter->Enter([&] {
+    return &self._class_ == cls ? self.Call(*method, args) : self.Call(method->name, args);
+  });
+}
+
+ObjectHolder MethodHandle::Invoke(const ObjectHolder& instance, initializer_list<ObjectHolder> args) const {
+  ClassInstance& self = AsInstance(instance);
+  return interpreter->Enter([&] {
+    return &self._class_ == cls ? self.Call(*method, args) : self.Call(method->name, vector<ObjectHolder>(args));
+  });
+}
+
+Module::Module(shared_ptr<const Program> program, OutputSink& output, Limits limits)
+  : interpreter(output, limits)
+{
+  interpreter.Run(std::move(program));
+}
+
+Module::Module(istream& source, OutputSink& output, Limits limits)
+  : Module(Program::Compile(source), output, limits)
+{
+}
+
+Module::~Module() {
+  try {
+    interpreter.Output().Flush();
+  } catch (...) {
+  }
+}
+
+ObjectHolder Module::Global(const string& name) {
+  const Closure& globals = interpreter.Globals();
+  if (auto it = globals.find(name); it != globals.end()) {
+    return it->second;
+  }
+  throw runtime_error("no global named " + name);
+}
+
+const Class& Module::GetClass(const string& name) {
+  const ObjectHolder global = Global(name);
+  if (KindOf(global) != ObjectKind::Class) {
+    throw runtime_error(name + " is not a class");
+  }
+  return static_cast<const Class&>(*global);
+}
+
+ObjectHolder Module::New(const Class& cls, const vector<ObjectHolder>& args) {
+  return interpreter.Enter([&] {
+    // Owned before __init__ runs, so a `self` it stores refers to the final object
+    ObjectHolder holder = ObjectHolder::Own(ClassInstance(cls));
+    if (const Method* init = cls.GetMethod("__init__")) {
+      static_cast<ClassInstance&>(*holder).Call(*init, args);
+    }
+    return holder;
+  });
+}
+
+ObjectHolder Module::Call(const ObjectHolder& instance, const string& method, const vector<ObjectHolder>& args) {
+  ClassInstance& self = AsInstance(instance);
+  return interpreter.Enter([&] { return self.Call(method, args); });
+}
+
+MethodHandle Module::Prepare(const Class& cls, const string& method) {
+  const Method* resolved = cls.GetMethod(method);
+  if (!resolved) {
+    throw runtime_error("class " + cls.GetName() + " has no method " + method);
+  }
+  return MethodHandle(interpreter, cls, *resolved);
+}
+
+} /* namespace Runtime */
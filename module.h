@@ -0,0 +1,115 @@
+#pragma once
+
+#include "interpreter.h"
+#include "object.h"
+#include "object_holder.h"
+#include "output_sink.h"
+#include "program.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Conversions between C++ values and Mython objects for hosts
+ObjectHolder ToObject(int64_t value);
+ObjectHolder ToObject(int value);
+ObjectHolder ToObject(double value);
+ObjectHolder ToObject(bool value);
+ObjectHolder ToObject(std::string value);
+ObjectHolder ToObject(const char* value);
+inline ObjectHolder ToObject(ObjectHolder value) { return value; }
+
+// Throws std::runtime_error if object does not hold a T. Numbers convert to
+// double, and any object converts to bool by its truth value.
+template <typename T>
+T FromObject(const ObjectHolder& object);
+
+template <> int64_t FromObject<int64_t>(const ObjectHolder& object);
+template <> double FromObject<double>(const ObjectHolder& object);
+template <> bool FromObject<bool>(const ObjectHolder& object);
+template <> std::string FromObject<std::string>(const ObjectHolder& object);
+template <> inline ObjectHolder FromObject<ObjectHolder>(const ObjectHolder& object) { return object; }
+
+class Module;
+
+// A method resolved once, for calling it many times. Instances of subclasses
+// that override the method are still dispatched to their own version. Call
+// passes its arguments without building a vector of them. Each call still
+// binds the interpreter to the thread, unless it is made under an
+// Interpreter::Session, which a host making many calls in a row should hold.
+class MethodHandle {
+public:
+  ObjectHolder operator()(const ObjectHolder& instance, const std::vector<ObjectHolder>& args) const;
+
+  template <typename R, typename... Args>
+  R Call(const ObjectHolder& instance, Args&&... args) const {
+    return FromObject<R>(Invoke(instance, {ToObject(std::forward<Args>(args))...}));
+  }
+
+private:
+  friend class Module;
+  MethodHandle(Interpreter& interpreter, const Class& cls, const Method& method)
+    : interpreter(&interpreter), cls(&cls), method(&method) {}
+
+  ObjectHolder Invoke(const ObjectHolder& instance, std::initializer_list<ObjectHolder> args) const;
+
+  Interpreter* interpreter;
+  const Class* cls;
+  const Method* method;
+};
+
+// A program loaded into its own Interpreter for a C++ host. Loading runs the
+// top level of the program once; afterwards the host looks up its classes and
+// globals, creates instances and calls their methods directly, without any
+// text being parsed. Calls run on the calling thread; a module must not be
+// used by two threads at the same time. Output is flushed when the sink's
+// policy says so and when the module is destroyed.
+class Module {
+public:
+  Module(std::shared_ptr<const Program> program, OutputSink& output, Limits limits = {});
+  Module(std::istream& source, OutputSink& output, Limits limits = {});
+  Module(const Module&) = delete;
+  Module& operator=(const Module&) = delete;
+  ~Module();
+
+  Interpreter& GetInterpreter() { return interpreter; }
+
+  // Throw std::runtime_error for missing names
+  ObjectHolder Global(const std::string& name);
+  const Class& GetClass(const std::string& name);
+
+  // Creates an instance, passing args to __init__ if the class has one
+  ObjectHolder New(const Class& cls, const std::vector<ObjectHolder>& args = {});
+
+  template <typename... Args>
+  ObjectHolder New(const std::string& class_name, Args&&... args) {
+    return New(GetClass(class_name), {ToObject(std::forward<Args>(args))...});
+  }
+
+  // Looks the method up by name on every call; see Prepare
+  ObjectHolder Call(const ObjectHolder& instance, const std::string& method, const std::vector<ObjectHolder>& args);
+
+  template <typename R, typename... Args>
+  R Call(const ObjectHolder& instance, const std::string& method, Args&&... args) {
+    return FromObject<R>(Call(instance, method, {ToObject(std::forward<Args>(args))...}));
+  }
+
+  // Throws std::runtime_error if the class has no such method
+  MethodHandle Prepare(const Class& cls, const std::string& method);
+
+private:
+  Interpreter interpreter;
+};
+
+void RunModuleTests(TestRunner& tr);
+
+} /* namespace Runtime */
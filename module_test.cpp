@@ -0,0 +1,136 @@
+#include "module.h"
+#include "call_stack.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+const string SCORING = R"(
+class Scorer:
+  def __init__(weight):
+    self.weight = weight
+    self.calls = 0
+
+  def score(x):
+    self.calls = self.calls + 1
+    return x * self.weight + 1
+
+  def label(name, loud):
+    if loud:
+      return name + '!'
+    return name
+
+  def ratio(x):
+    return x / 2.0
+
+  def depth(n):
+    if n == 0:
+      return 0
+    return 1 + self.depth(n - 1)
+
+class Doubled(Scorer):
+  def score(x):
+    return 2 * x
+
+greeting = 'hello'
+print 'loaded'
+)";
+
+}
+
+void TestModuleCalls() {
+  istringstream source(SCORING);
+  ostringstream os;
+  StreamSink output(os);
+  Module module(source, output);
+  ASSERT_EQUAL(os.str(), "loaded\n");
+
+  ASSERT_EQUAL(FromObject<string>(module.Global("greeting")), "hello");
+  ASSERT_THROWS(module.Global("missing"), runtime_error);
+  ASSERT_THROWS(module.GetClass("greeting"), runtime_error);
+
+  ObjectHolder scorer = module.New("Scorer", 3);
+  ASSERT_EQUAL(module.Call<int64_t>(scorer, "score", 5), 16);
+  ASSERT_EQUAL(module.Call<string>(scorer, "label", "top", true), "top!");
+  ASSERT_EQUAL(module.Call<string>(scorer, "label", "top", false), "top");
+  ASSERT_EQUAL(module.Call<double>(scorer, "ratio", 3), 1.5);
+  ASSERT_THROWS(module.Call<string>(scorer, "score", 1), runtime_error);
+  ASSERT_THROWS(module.Call(scorer, "score", {}), runtime_error);
+  ASSERT_THROWS(module.Call(module.Global("greeting"), "score", {}), runtime_error);
+
+  const Class& scorer_class = module.GetClass("Scorer");
+  const MethodHandle score = module.Prepare(scorer_class, "score");
+  int64_t total = 0;
+  for (int64_t i = 0; i < 1000; ++i) {
+    total += score.Call<int64_t>(scorer, i);
+  }
+  ASSERT_EQUAL(total, 3 * 499500 + 1000);
+  ASSERT_EQUAL(FromObject<int64_t>(scorer.TryAs<ClassInstance>()->Fields().at("calls")), 1002);
+
+  // Overrides win over the prepared method of the base class
+  ObjectHolder doubled = module.New("Doubled", 7);
+  ASSERT_EQUAL(score.Call<int64_t>(doubled, 5), 10);
+  ASSERT_THROWS(module.Prepare(scorer_class, "missing"), runtime_error);
+}
+
+void TestModuleLimits() {
+  istringstream source(SCORING);
+  ostringstream os;
+  StreamSink output(os);
+  Limits limits;
+  limits.max_depth = 100;
+  Module module(source, output, limits);
+
+  ObjectHolder scorer = module.New("Scorer", 1);
+  const MethodHandle depth = module.Prepare(module.GetClass("Scorer"), "depth");
+  ASSERT_EQUAL(depth.Call<int64_t>(scorer, 50), 50);
+  ASSERT_THROWS(depth.Call<int64_t>(scorer, 500), RecursionError);
+  // The failed call leaves nothing behind
+  ASSERT_EQUAL(CallStack::Current().Depth(), 0u);
+  ASSERT_EQUAL(depth.Call<int64_t>(scorer, 99), 99);
+}
+
+void TestModuleSession() {
+  istringstream source(SCORING);
+  ostringstream os;
+  StreamSink output(os);
+  Limits limits;
+  limits.max_depth = 100;
+  Module module(source, output, limits);
+
+  ObjectHolder scorer = module.New("Scorer", 2);
+  const MethodHandle score = module.Prepare(module.GetClass("Scorer"), "score");
+  const MethodHandle depth = module.Prepare(module.GetClass("Scorer"), "depth");
+  {
+    Interpreter::Session session(module.GetInterpreter());
+    ASSERT(Interpreter::Current() == &module.GetInterpreter());
+    int64_t total = 0;
+    for (int64_t i = 0; i < 100; ++i) {
+      total += score.Call<int64_t>(scorer, i);
+    }
+    ASSERT_EQUAL(total, 2 * 4950 + 100);
+    ASSERT_EQUAL(module.Call<int64_t>(scorer, "score", 1), 3);
+
+    // The recursion limit still counts from where the host stands
+    ASSERT_EQUAL(depth.Call<int64_t>(scorer, 99), 99);
+    ASSERT_THROWS(depth.Call<int64_t>(scorer, 500), RecursionError);
+    ASSERT_EQUAL(CallStack::Current().Depth(), 0u);
+    ASSERT_EQUAL(depth.Call<int64_t>(scorer, 10), 10);
+  }
+  ASSERT(Interpreter::Current() == nullptr);
+}
+
+void RunModuleTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestModuleCalls);
+  RUN_TEST(tr, Runtime::TestModuleLimits);
+  RUN_TEST(tr, Runtime::TestModuleSession);
+}
+
+} /* namespace Runtime */
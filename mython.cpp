@@ -3,6 +3,20 @@
 #include "statement.h"
 #include "lexer.h"
 #include "parse.h"
+#include "output_sink.h"
+#include "call_stack.h"
+#include "native_class.h"
+#include "interpreter.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "snapshot.h"
+#include "program_cache.h"
+#include "batch.h"
+#include "server.h"
+#include "module.h"
+#include "record_stream.h"
+#include "thread_pool.h"
+#include "benchmarks.h"
 #include "test_runner.h"
 
 #include <memory>
@@ -12,24 +26,220 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <cstdlib>
+#include <iterator>
+
+#include <signal.h>
+#include <unistd.h>
 
 using namespace std;
 
 void TestAll();
 
-void RunMythonProgram(istream& input, ostream& output) {
-  Ast::Print::SetOutputStream(output);
+namespace {
 
-  Parse::Lexer lexer(input);
-  auto program = ParseProgram(lexer);
+Runtime::Server* serving = nullptr;
 
-  Runtime::Closure closure;
-  program->Execute(closure);
+void StopServing(int) {
+  serving->Stop();
 }
 
-int main() {
+// Goes through the cache whenever there is one, whichever way the script
+// was given
+shared_ptr<const Runtime::Program> CompileScript(istream& script, const string& cache_dir, ParseOptions options) {
+  if (cache_dir.empty()) {
+    return Runtime::Program::Compile(script, options);
+  }
+  const string source{istreambuf_iterator<char>(script), istreambuf_iterator<char>()};
+  return Runtime::ProgramCache(cache_dir).Compile(source, options);
+}
+
+}
+
+void RunMythonProgram(istream& input, Runtime::OutputSink& output, Runtime::Limits limits = {}) {
+  Runtime::Interpreter interpreter(output, limits);
+  interpreter.Run(input);
+}
+
+void RunMythonProgram(istream& input, ostream& output) {
+  Runtime::StreamSink sink(output);
+  RunMythonProgram(input, sink);
+}
+
+int main(int argc, char* argv[]) {
   // TestAll();
-  RunMythonProgram(cin, cout);
+  if (argc > 1 && string(argv[1]) == "--benchmark") {
+    RunBenchmarks();
+    return 0;
+  }
+  Runtime::Limits limits;
+  string manifest_path;
+  size_t threads = thread::hardware_concurrency();
+  const char* cache_variable = getenv("MYTHON_CACHE_DIR");
+  string cache_dir = cache_variable ? cache_variable : "";
+  ParseOptions parse_options;
+  string serve_socket, connect_socket, script_path;
+  vector<string> preload;
+  size_t workers = 0;
+  Runtime::RequestLimits request_limits;
+  string stream_target, records_path;
+  Runtime::StreamOptions stream_options;
+  for (int i = 1; i < argc; ++i) {
+    const string option = argv[i];
+    if (option == "--lazy-methods") {
+      parse_options.lazy_method_bodies = true;
+      continue;
+    }
+    if (i + 1 == argc) {
+      cerr << "missing value for " << option << endl;
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (option == "--batch") {
+      manifest_path = value;
+    } else if (option == "--threads") {
+      threads = stoul(value);
+    } else if (option == "--recursion-limit") {
+      limits.max_depth = stoul(value);
+    } else if (option == "--memory-limit") {
+      limits.max_memory = stoull(value);
+    } else if (option == "--cache-dir") {
+      cache_dir = value;
+    } else if (option == "--serve") {
+      serve_socket = value;
+    } else if (option == "--workers") {
+      workers = stoul(value);
+    } else if (option == "--request-timeout") {
+      request_limits.max_run_time = chrono::milliseconds(stoul(value));
+    } else if (option == "--request-steps") {
+      request_limits.max_steps = stoul(value);
+    } else if (option == "--io-timeout") {
+      request_limits.io_timeout = chrono::milliseconds(stoul(value));
+    } else if (option == "--max-request-size") {
+      request_limits.max_request_size = stoull(value);
+    } else if (option == "--preload") {
+      preload.push_back(value);
+    } else if (option == "--stream") {
+      stream_target = value;
+    } else if (option == "--records") {
+      records_path = value;
+    } else if (option == "--record-format") {
+      if (string(value) == "lines") {
+        stream_options.format = Runtime::RecordFormat::Lines;
+      } else if (string(value) == "length") {
+        stream_options.format = Runtime::RecordFormat::LengthPrefixed;
+      } else {
+        cerr << "record format must be lines or length" << endl;
+        return 1;
+      }
+    } else if (option == "--batch-size") {
+      stream_options.batch_size = stoul(value);
+    } else if (option == "--connect") {
+      connect_socket = value;
+    } else if (option == "--script") {
+      script_path = value;
+    } else {
+      cerr << "unknown option " << option << endl;
+      return 1;
+    }
+  }
+  if (!stream_target.empty()) {
+    const size_t dot = stream_target.find('.');
+    if (dot == string::npos || script_path.empty()) {
+      cerr << "usage: --stream Class.method --script PATH [--records PATH]" << endl;
+      return 1;
+    }
+    stream_options.class_name = stream_target.substr(0, dot);
+    stream_options.method = stream_target.substr(dot + 1);
+    ifstream script(script_path);
+    ifstream records_file;
+    if (!records_path.empty()) {
+      records_file.open(records_path, ios::binary);
+    }
+    if (!script || (!records_path.empty() && !records_file)) {
+      cerr << "cannot open " << (script ? records_path : script_path) << endl;
+      return 1;
+    }
+    // Only RunStream flushes, once per batch
+    Runtime::FdSink output(STDOUT_FILENO, Runtime::FlushPolicy::OnExit);
+    try {
+      Runtime::Module module(CompileScript(script, cache_dir, parse_options), output, limits);
+      const auto report = Runtime::RunStream(
+        module, stream_options, records_path.empty() ? cin : records_file, output
+      );
+      Runtime::PrintStreamReport(report, cerr);
+    } catch (const exception& error) {
+      cerr << error.what() << endl;
+      return 1;
+    }
+    return 0;
+  }
+  if (!serve_socket.empty()) {
+    Runtime::Server server(serve_socket, threads, limits, parse_options, request_limits);
+    for (const string& path : preload) {
+      try {
+        server.Preload(path);
+      } catch (const exception& error) {
+        cerr << "cannot preload " << path << ": " << error.what() << endl;
+        return 1;
+      }
+    }
+    serving = &server;
+    signal(SIGINT, StopServing);
+    signal(SIGTERM, StopServing);
+    if (workers > 0) {
+      server.ServeForked(workers);
+    } else {
+      server.Serve();
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    return 0;
+  }
+  if (!connect_socket.empty()) {
+    if (script_path.empty()) {
+      cerr << "--connect needs --script" << endl;
+      return 1;
+    }
+    Runtime::FdSink output(STDOUT_FILENO, Runtime::FlushPolicy::OnSize);
+    return Runtime::RunClient(connect_socket, script_path, cin, output, cerr);
+  }
+  if (!manifest_path.empty()) {
+    ifstream manifest(manifest_path);
+    if (!manifest) {
+      cerr << "cannot open manifest " << manifest_path << endl;
+      return 1;
+    }
+    const Runtime::ProgramCache cache(cache_dir);
+    const auto report = Runtime::RunBatch(
+      Runtime::ReadManifest(manifest), threads, limits, cache_dir.empty() ? nullptr : &cache
+    );
+    Runtime::PrintBatchReport(report, cerr);
+    return report.failed == 0 ? 0 : 1;
+  }
+  const auto policy = isatty(STDOUT_FILENO) ? Runtime::FlushPolicy::OnNewline : Runtime::FlushPolicy::OnSize;
+  Runtime::FdSink output(STDOUT_FILENO, policy);
+  try {
+    Runtime::Interpreter interpreter(output, limits);
+    if (!script_path.empty()) {
+      ifstream script(script_path);
+      if (!script) {
+        cerr << "cannot open script " << script_path << endl;
+        return 1;
+      }
+      interpreter.SetInput(cin);
+      interpreter.Run(CompileScript(script, cache_dir, parse_options));
+    } else {
+      interpreter.Run(CompileScript(cin, cache_dir, parse_options));
+    }
+  } catch (const Runtime::RecursionError& error) {
+    cerr << "RecursionError: " << error.what() << endl;
+    return 1;
+  } catch (const Runtime::MemoryError& error) {
+    cerr << "MemoryError: " << error.what() << endl;
+    return 1;
+  }
   return 0;
 }
 
@@ -80,6 +290,39 @@ void TestArithmetics() {
   ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
 }
 
+void TestLongArithmetics() {
+  istringstream input(R"(
+big = 9223372036854775807
+print big + 1, -big - 2, big * big, 100000000000000000000 / 3
+print (big + 1) - 1, 36893488147419103232 / 4 / 2, big + 1 > big
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(),
+    "9223372036854775808 -9223372036854775809 85070591730234615847396907784232501249 33333333333333333333\n"
+    "9223372036854775807 4611686018427387904 True\n"
+  );
+}
+
+void TestFloatArithmetics() {
+  istringstream input(R"(
+a = 1.5
+b = a * 2.0 + 1.0
+print a, b, 7 / 2, 7.0 / 2, 1 + 0.25, 0.1 + 0.2, -2.5 * 4
+print 3 == 3.0, 2.5 < 3, 100000000000000000000 > 1.5, str(10.0 / 4)
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(),
+    "1.5 4.0 3 3.5 1.25 0.30000000000000004 -10.0\n"
+    "True True True 2.5\n"
+  );
+}
+
 void TestVariablesArePointers() {
   istringstream input(R"(
 class Counter:
@@ -113,10 +356,46 @@ print y.value
   ASSERT_EQUAL(output.str(), "2\n3\n");
 }
 
+void TestRecursionLimit() {
+  const string program = R"(
+class Chain:
+  def depth(n):
+    if n == 0:
+      return 0
+    return 1 + self.depth(n - 1)
+
+chain = Chain()
+print chain.depth(5000)
+print chain.depth(20000)
+)";
+
+  istringstream input(program);
+  ostringstream output;
+  ASSERT_THROWS(RunMythonProgram(input, output), Runtime::RecursionError);
+  ASSERT_EQUAL(output.str(), "5000\n");
+  ASSERT_EQUAL(Runtime::CallStack::Current().Depth(), 0u);
+}
+
 void TestAll() {
   TestRunner tr;
   Runtime::RunObjectHolderTests(tr);
   Runtime::RunObjectsTests(tr);
+  Runtime::RunBigIntTests(tr);
+  Runtime::RunCallStackTests(tr);
+  Runtime::RunBuiltinsTests(tr);
+  Runtime::RunNativeClassTests(tr);
+  Runtime::RunInterpreterTests(tr);
+  Runtime::RunSchedulerTests(tr);
+  Runtime::RunMemoryTests(tr);
+  Runtime::RunSnapshotTests(tr);
+  Runtime::RunProgramCacheTests(tr);
+  RunThreadPoolTests(tr);
+  Runtime::RunBatchTests(tr);
+  Runtime::RunServerTests(tr);
+  Runtime::RunModuleTests(tr);
+  Runtime::RunRecordStreamTests(tr);
+  Runtime::RunHashTableTests(tr);
+  Runtime::RunOutputSinkTests(tr);
   Ast::RunUnitTests(tr);
   Parse::RunLexerTests(tr);
   TestParseProgram(tr);
@@ -124,5 +403,8 @@ void TestAll() {
   RUN_TEST(tr, TestSimplePrints);
   RUN_TEST(tr, TestAssignments);
   RUN_TEST(tr, TestArithmetics);
+  RUN_TEST(tr, TestLongArithmetics);
+  RUN_TEST(tr, TestFloatArithmetics);
+  RUN_TEST(tr, TestRecursionLimit);
   RUN_TEST(tr, TestVariablesArePointers);
 }
@@ -0,0 +1,27 @@
+#include "native_class.h"
+#include "statement.h"
+
+#include <stdexcept>
+
+namespace Runtime {
+
+NativeClassRegistry& NativeClassRegistry::Instance() {
+  static NativeClassRegistry registry;
+  return registry;
+}
+
+const Class& NativeClassRegistry::Register(std::string name, std::vector<Method> methods,
+                                           PayloadFactory payload_factory, const Class* parent) {
+  if (classes.count(name)) {
+    throw std::runtime_error("native class " + name + " is already registered");
+  }
+  ObjectHolder cls = ObjectHolder::Own(Class(name, std::move(methods), parent, payload_factory));
+  return static_cast<const Class&>(*classes.emplace(std::move(name), std::move(cls)).first->second);
+}
+
+const Class* NativeClassRegistry::Find(const std::string& name) const {
+  auto it = classes.find(name);
+  return it != classes.end() ? static_cast<const Class*>(it->second.Get()) : nullptr;
+}
+
+} /* namespace Runtime */
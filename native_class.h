@@ -0,0 +1,38 @@
+#pragma once
+
+#include "object.h"
+
+#include <any>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Payload factory for a default-constructed T
+template <typename T>
+std::any MakePayload() {
+  return T{};
+}
+
+// Classes implemented in C++: their methods are NativeMethods working on a
+// payload stored in each instance. Scripts see them like their own classes,
+// can instantiate them and derive from them.
+class NativeClassRegistry {
+public:
+  static NativeClassRegistry& Instance();
+
+  // Throws if a class with this name is already registered
+  const Class& Register(std::string name, std::vector<Method> methods, PayloadFactory payload_factory,
+                        const Class* parent = nullptr);
+  const Class* Find(const std::string& name) const;
+
+private:
+  std::unordered_map<std::string, ObjectHolder> classes;
+};
+
+void RunNativeClassTests(TestRunner& tr);
+
+} /* namespace Runtime */
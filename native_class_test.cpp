@@ -0,0 +1,92 @@
+#include "native_class.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+
+using namespace std;
+
+namespace Runtime {
+
+struct Accumulator {
+  int64_t total = 0;
+  int64_t calls = 0;
+};
+
+ObjectHolder AccumulatorInit(ClassInstance& self, const vector<ObjectHolder>& args) {
+  self.Payload<Accumulator>().total = args[0].TryAs<Number>()->GetValue();
+  return ObjectHolder::None();
+}
+
+ObjectHolder AccumulatorAdd(ClassInstance& self, const vector<ObjectHolder>& args) {
+  Accumulator& state = self.Payload<Accumulator>();
+  state.total += args[0].TryAs<Number>()->GetValue();
+  ++state.calls;
+  return ObjectHolder::Own(Number(state.total));
+}
+
+ObjectHolder AccumulatorCalls(ClassInstance& self, const vector<ObjectHolder>&) {
+  return ObjectHolder::Own(Number(self.Payload<Accumulator>().calls));
+}
+
+const Class& RegisterAccumulator() {
+  static const Class& cls = [] () -> const Class& {
+    vector<Method> methods;
+    methods.push_back({"__init__", {"start"}, nullptr, AccumulatorInit});
+    methods.push_back({"add", {"value"}, nullptr, AccumulatorAdd});
+    methods.push_back({"calls", {}, nullptr, AccumulatorCalls});
+    return NativeClassRegistry::Instance().Register("Accumulator", std::move(methods), MakePayload<Accumulator>);
+  }();
+  return cls;
+}
+
+void TestNativeClassCalls() {
+  const Class& cls = RegisterAccumulator();
+  ASSERT(NativeClassRegistry::Instance().Find("Accumulator") == &cls);
+  ASSERT_THROWS(NativeClassRegistry::Instance().Register("Accumulator", {}, MakePayload<int>), runtime_error);
+
+  ClassInstance instance(cls);
+  instance.Call("__init__", {ObjectHolder::Own(Number(10))});
+  instance.Call("add", {ObjectHolder::Own(Number(5))});
+  ASSERT_EQUAL(instance.Payload<Accumulator>().total, 15);
+  ASSERT_EQUAL(instance.Call("calls", {}).TryAs<Number>()->GetValue(), 1);
+  ASSERT_THROWS(instance.Call("add", {}), runtime_error);
+  ASSERT_THROWS(instance.Payload<string>(), runtime_error);
+}
+
+void TestNativeClassInScripts() {
+  RegisterAccumulator();
+  istringstream program(R"(
+class Scaled(Accumulator):
+  def add_scaled(value, factor):
+    return self.add(value * factor)
+
+  def __str__():
+    return 'Scaled after ' + str(self.calls()) + ' calls'
+
+a = Accumulator(1)
+a.add(2)
+s = Scaled(100)
+s.add(1)
+print a.add(3), s.add_scaled(2, 10), s
+)");
+
+  ostringstream output;
+  Ast::Print::SetOutputStream(output);
+  Parse::Lexer lexer(program);
+  auto tree = ParseProgram(lexer);
+  Closure closure;
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(output.str(), "6 121 Scaled after 2 calls\n");
+}
+
+void RunNativeClassTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestNativeClassCalls);
+  RUN_TEST(tr, Runtime::TestNativeClassInScripts);
+}
+
+} /* namespace Runtime */
@@ -1,6 +1,10 @@
 #include "object.h"
 #include "statement.h"
+#include "format.h"
+#include "comparators.h"
+#include "call_stack.h"
 
+#include <algorithm>
 #include <sstream>
 #include <string_view>
 
@@ -10,6 +14,407 @@ using namespace std;
 
 namespace Runtime {
 
+void Object::PrintTo(std::string& buffer) {
+    std::ostringstream os;
+    Print(os);
+    buffer.append(os.str());
+}
+
+template <>
+void ValueObject<int64_t>::PrintTo(std::string& buffer) { AppendNumber(buffer, value); }
+
+template <>
+void ValueObject<BigInt>::PrintTo(std::string& buffer) { buffer.append(value.ToString()); }
+
+template <>
+void ValueObject<double>::Print(std::ostream& os) {
+    std::string buffer;
+    PrintTo(buffer);
+    os << buffer;
+}
+
+template <>
+void ValueObject<double>::PrintTo(std::string& buffer) { AppendFloat(buffer, value); }
+
+template <>
+void ValueObject<std::string>::PrintTo(std::string& buffer) { buffer.append(value); }
+
+String::String(const String& other)
+    : ValueObject<std::string>(other.value), hash(other.hash.load(std::memory_order_relaxed)) {}
+
+String::String(String&& other)
+    : ValueObject<std::string>(std::move(other.value)), hash(other.hash.load(std::memory_order_relaxed)) {
+    other.hash.store(0, std::memory_order_relaxed);
+}
+
+size_t String::Hash() const {
+    size_t result = hash.load(std::memory_order_relaxed);
+    if (result == 0) {
+        // Zero marks "not computed yet", so a genuine zero hash is remapped.
+        result = std::hash<std::string>{}(value);
+        result = result == 0 ? 1 : result;
+        hash.store(result, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+bool operator==(const String& lhs, const String& rhs) {
+    if (&lhs == &rhs) {
+        return true;
+    }
+    if (lhs.IsInterned() && rhs.IsInterned()) {
+        return false;
+    }
+    if (lhs.GetValue().size() != rhs.GetValue().size()) {
+        return false;
+    }
+    size_t lhs_hash = lhs.hash.load(std::memory_order_relaxed);
+    size_t rhs_hash = rhs.hash.load(std::memory_order_relaxed);
+    if (lhs_hash != 0 && rhs_hash != 0 && lhs_hash != rhs_hash) {
+        return false;
+    }
+    return lhs.GetValue() == rhs.GetValue();
+}
+
+StringPool& StringPool::Instance() {
+    // Never destroyed: programs held by static objects release their literals
+    // during exit, in no particular order with respect to the pool
+    static StringPool* pool = new StringPool;
+    return *pool;
+}
+
+StringPool::Entry& StringPool::Find(std::string_view value) {
+    if (auto it = strings.find(value); it != strings.end()) {
+        return it->second;
+    }
+    auto str = std::make_unique<String>(std::string(value));
+    str->interned = true;
+    str->Hash();
+    // The key views the characters of the string it maps to
+    const std::string_view key = str->GetValue();
+    return strings.emplace(key, Entry{std::move(str)}).first->second;
+}
+
+String& StringPool::Intern(std::string_view value) {
+    std::lock_guard guard(mutex);
+    Entry& entry = Find(value);
+    entry.permanent = true;
+    return *entry.string;
+}
+
+String& StringPool::Acquire(std::string_view value) {
+    std::lock_guard guard(mutex);
+    Entry& entry = Find(value);
+    ++entry.acquired;
+    return *entry.string;
+}
+
+void StringPool::Release(String& string) {
+    std::lock_guard guard(mutex);
+    auto it = strings.find(string.GetValue());
+    if (--it->second.acquired == 0 && !it->second.permanent) {
+        strings.erase(it);
+    }
+}
+
+String* StringPool::InternAtRuntime(std::string_view value) {
+    std::lock_guard guard(mutex);
+    if (auto it = strings.find(value); it != strings.end() && it->second.permanent) {
+        return it->second.string.get();
+    }
+    if (runtime_strings == max_runtime_strings) {
+        return nullptr;
+    }
+    ++runtime_strings;
+    Entry& entry = Find(value);
+    entry.permanent = true;
+    return entry.string.get();
+}
+
+size_t StringPool::Size() const {
+    std::lock_guard guard(mutex);
+    return strings.size();
+}
+
+ObjectHolder MakeString(std::string value) {
+    StringPool& pool = StringPool::Instance();
+    if (pool.RuntimeInterning() && value.size() <= StringPool::MAX_RUNTIME_LENGTH) {
+        if (String* interned = pool.InternAtRuntime(value)) {
+            return ObjectHolder::Share(*interned);
+        }
+    }
+    return ObjectHolder::Own(String(std::move(value)));
+}
+
+namespace {
+// References to containers taken out of containers being destroyed. They are
+// dropped one at a time by the outermost of the destructors running on this
+// thread, so releasing a list nested a million times, or a long chain of
+// instances, takes a loop rather than a million nested destructor calls. Every
+// owning reference is taken out, shared or not: one left behind could become
+// the last only when the members of the dying object are destroyed.
+// Non-owning ones (self, classes, literals) are never looked at, as what they
+// refer to may already be gone: an interpreter releases its programs before
+// its globals.
+thread_local std::vector<ObjectHolder>* release_queue = nullptr;
+
+bool HoldsReferences(const ObjectHolder& object) {
+    switch (KindOf(object)) {
+        case ObjectKind::List:
+        case ObjectKind::Dict:
+        case ObjectKind::Instance:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// for_each_reference calls its argument with every holder the dying object owns
+template <typename F>
+void ReleaseReferences(F for_each_reference) {
+    auto defer = [](ObjectHolder& reference) {
+        if (reference.IsOwning() && HoldsReferences(reference)) {
+            release_queue->push_back(std::move(reference));
+        }
+    };
+    if (release_queue) {
+        for_each_reference(defer);
+        return;
+    }
+    std::vector<ObjectHolder> queue;
+    release_queue = &queue;
+    for_each_reference(defer);
+    while (!queue.empty()) {
+        // Its destructor adds what it owns to the queue
+        ObjectHolder last = std::move(queue.back());
+        queue.pop_back();
+    }
+    release_queue = nullptr;
+}
+}
+
+List::~List() {
+    ReleaseReferences([this](auto defer) {
+        for (ObjectHolder& item : items) {
+            defer(item);
+        }
+    });
+}
+
+Dict::~Dict() {
+    ReleaseReferences([this](auto defer) {
+        table.ForEach([&defer](HashTable::Entry& entry) { defer(entry.value); });
+    });
+}
+
+ClassInstance::~ClassInstance() {
+    ReleaseReferences([this](auto defer) {
+        for (auto& [name, field] : fields) {
+            defer(field);
+        }
+    });
+}
+
+void List::Print(std::ostream& os) {
+    std::string buffer;
+    PrintTo(buffer);
+    os << buffer;
+}
+
+namespace {
+// Containers being printed on this thread, innermost last. One that contains
+// itself prints as [...] or {...} the second time it is reached, as in Python.
+thread_local std::vector<const Object*> printing;
+
+class PrintingScope {
+public:
+    explicit PrintingScope(const Object& container) : reentered(
+        std::find(printing.begin(), printing.end(), &container) != printing.end()
+    ) {
+        if (!reentered) {
+            printing.push_back(&container);
+        }
+    }
+    PrintingScope(const PrintingScope&) = delete;
+    PrintingScope& operator=(const PrintingScope&) = delete;
+    ~PrintingScope() {
+        if (!reentered) {
+            printing.pop_back();
+        }
+    }
+
+    const bool reentered;
+};
+
+// Elements of containers are printed the way they are written: strings quoted
+void AppendItem(std::string& buffer, const ObjectHolder& item) {
+    if (!item) {
+        buffer.append(NONE_LITERAL);
+    } else if (item->Kind() == ObjectKind::String) {
+        buffer.push_back('\'');
+        buffer.append(static_cast<const String&>(*item).GetValue());
+        buffer.push_back('\'');
+    } else {
+        const_cast<Object&>(*item).PrintTo(buffer);
+    }
+}
+}
+
+void List::PrintTo(std::string& buffer) {
+    CheckNativeStack("print");
+    const PrintingScope scope(*this);
+    if (scope.reentered) {
+        buffer.append("[...]");
+        return;
+    }
+    buffer.push_back('[');
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i > 0) {
+            buffer.append(", ");
+        }
+        AppendItem(buffer, items[i]);
+    }
+    buffer.push_back(']');
+}
+
+void List::Append(ObjectHolder item) {
+    if (items.size() == items.capacity()) {
+        const size_t capacity = std::max<size_t>(2 * items.capacity(), 4);
+        growth.Add((capacity - items.capacity()) * sizeof(ObjectHolder));
+        items.reserve(capacity);
+    }
+    items.push_back(std::move(item));
+}
+
+size_t List::Position(const ObjectHolder& index) const {
+    if (KindOf(index) != ObjectKind::Number) {
+        throw std::runtime_error("list indices must be integers");
+    }
+    int64_t position = static_cast<const Number&>(*index).GetValue();
+    if (position < 0) {
+        position += static_cast<int64_t>(items.size());
+    }
+    if (position < 0 || position >= static_cast<int64_t>(items.size())) {
+        throw std::runtime_error("list index out of range");
+    }
+    return static_cast<size_t>(position);
+}
+
+ObjectHolder List::Call(const std::string& method, const std::vector<ObjectHolder>& actual_args) {
+    if (method == "append" && actual_args.size() == 1) {
+        Append(actual_args[0]);
+        return ObjectHolder::None();
+    }
+    if (method == "pop" && actual_args.size() <= 1) {
+        if (items.empty()) {
+            throw std::runtime_error("pop from empty list");
+        }
+        size_t position = actual_args.empty() ? items.size() - 1 : Position(actual_args[0]);
+        ObjectHolder result = std::move(items[position]);
+        items.erase(items.begin() + position);
+        return result;
+    }
+    throw std::runtime_error("list has no method " + method + " with " + std::to_string(actual_args.size()) + " arguments");
+}
+
+void Dict::Print(std::ostream& os) {
+    std::string buffer;
+    PrintTo(buffer);
+    os << buffer;
+}
+
+void Dict::PrintTo(std::string& buffer) {
+    CheckNativeStack("print");
+    const PrintingScope scope(*this);
+    if (scope.reentered) {
+        buffer.append("{...}");
+        return;
+    }
+    buffer.push_back('{');
+    bool first = true;
+    table.ForEach([&buffer, &first](const HashTable::Entry& entry) {
+        if (!first) {
+            buffer.append(", ");
+        }
+        first = false;
+        AppendItem(buffer, entry.key);
+        buffer.append(": ");
+        AppendItem(buffer, entry.value);
+    });
+    buffer.push_back('}');
+}
+
+ObjectHolder Dict::Call(const std::string& method, const std::vector<ObjectHolder>& actual_args) {
+    if (method == "get" && (actual_args.size() == 1 || actual_args.size() == 2)) {
+        const ObjectHolder* value = table.Find(actual_args[0]);
+        if (value) {
+            return *value;
+        }
+        return actual_args.size() == 2 ? actual_args[1] : ObjectHolder::None();
+    }
+    if (method == "pop" && actual_args.size() == 1) {
+        const ObjectHolder* value = table.Find(actual_args[0]);
+        if (!value) {
+            throw std::runtime_error("key not found in dict");
+        }
+        ObjectHolder result = *value;
+        table.Erase(actual_args[0]);
+        return result;
+    }
+    if ((method == "keys" || method == "values") && actual_args.empty()) {
+        std::vector<ObjectHolder> result;
+        result.reserve(table.Size());
+        const bool keys = method == "keys";
+        table.ForEach([&result, keys](const HashTable::Entry& entry) {
+            result.push_back(keys ? entry.key : entry.value);
+        });
+        return ObjectHolder::Own(List(std::move(result)));
+    }
+    throw std::runtime_error("dict has no method " + method + " with " + std::to_string(actual_args.size()) + " arguments");
+}
+
+bool Contains(const ObjectHolder& container, const ObjectHolder& item) {
+    switch (KindOf(container)) {
+        case ObjectKind::Dict:
+            return static_cast<const Dict&>(*container).Table().Find(item) != nullptr;
+        case ObjectKind::List:
+            for (const ObjectHolder& element : static_cast<const List&>(*container).Items()) {
+                if (Compare(CompareOp::Equal, element, item)) {
+                    return true;
+                }
+            }
+            return false;
+        case ObjectKind::String:
+            if (KindOf(item) != ObjectKind::String) {
+                throw std::runtime_error("'in <string>' requires a string as left operand");
+            }
+            return static_cast<const String&>(*container).GetValue().find(
+                static_cast<const String&>(*item).GetValue()) != std::string::npos;
+        default:
+            throw std::runtime_error("argument of 'in' is not a container");
+    }
+}
+
+TailCall::TailCall(ObjectHolder target, const std::string& method, std::vector<ObjectHolder> args)
+    : Object(ObjectKind::TailCall), target(std::move(target)), method(&method), args(std::move(args)) {}
+
+void TailCall::Print(std::ostream& os) {
+    os << "<tail call of " << *method << ">";
+}
+
+ObjectHolder CallMethod(ObjectHolder& target, const std::string& method, const std::vector<ObjectHolder>& actual_args) {
+    switch (KindOf(target)) {
+        case ObjectKind::Instance:
+            return static_cast<ClassInstance&>(*target).Call(method, actual_args);
+        case ObjectKind::List:
+            return static_cast<List&>(*target).Call(method, actual_args);
+        case ObjectKind::Dict:
+            return static_cast<Dict&>(*target).Call(method, actual_args);
+        default:
+            throw std::runtime_error("cannot call method " + method + " of a value without methods");
+    }
+}
+
 void PrintClosure(const Closure& closure) {
     for (const auto& item : closure) {
         std::cout << item.first << std::endl;
@@ -25,56 +430,111 @@ void ClassInstance::Print(std::ostream& os) {
         Call("__str__", {}).Get()->Print(os);
     }
 }
-bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
-    bool result = false;
-    for (const auto& class_method : _class_.class_methods) {
-        if (class_method.name == method && class_method.formal_params.size() == argument_count) {
-            result = true;
-        }
+
+void ClassInstance::PrintTo(std::string& buffer) {
+    if (!HasMethod("__str__", 0)) {
+        AppendPointer(buffer, this);
+        return;
     }
-    return result;
+    ObjectHolder str = Call("__str__", {});
+    if (str) { str->PrintTo(buffer); }
+    else { buffer.append(NONE_LITERAL); }
+}
+bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
+    const Method* class_method = _class_.GetMethod(method);
+    return class_method && class_method->formal_params.size() == argument_count;
 }
 
 const Closure& ClassInstance::Fields() const { return fields; }
 Closure& ClassInstance::Fields() { return fields; }
-ClassInstance::ClassInstance(const Class& cls) : _class_(cls) {
+ClassInstance::ClassInstance(const Class& cls) : Object(ObjectKind::Instance), _class_(cls) {
+    fields["self"] = ObjectHolder::Share(*this);
+    if (cls.payload_factory) {
+        payload = cls.payload_factory();
+    }
+}
+
+ClassInstance::ClassInstance(const ClassInstance& other) : Object(ObjectKind::Instance), _class_(other._class_), fields(other.fields), payload(other.payload) {
     fields["self"] = ObjectHolder::Share(*this);
 }
 
-ClassInstance::ClassInstance (ClassInstance&& other) : fields(std::move(other.fields)), _class_(std::move(other._class_)) {
+ClassInstance::ClassInstance (ClassInstance&& other) : Object(ObjectKind::Instance), fields(std::move(other.fields)), _class_(std::move(other._class_)), payload(std::move(other.payload)) {
     fields["self"] = ObjectHolder::Share(*this);
 }
 
 ObjectHolder ClassInstance::Call(const std::string& method, const std::vector<ObjectHolder>& actual_args) {
-    const Runtime::Method * method_of_class = _class_.GetMethod(method);
+    return FinishTailCalls(Invoke(method, actual_args));
+}
+
+ObjectHolder ClassInstance::Call(const Method& method, const std::vector<ObjectHolder>& actual_args) {
+    return FinishTailCalls(Invoke(method.name, &method, actual_args));
+}
+
+ObjectHolder ClassInstance::Call(const Method& method, std::initializer_list<ObjectHolder> actual_args) {
+    return FinishTailCalls(Invoke(method.name, &method, actual_args));
+}
+
+ObjectHolder ClassInstance::FinishTailCalls(ObjectHolder result) {
+    while (KindOf(result) == ObjectKind::TailCall) {
+        ObjectHolder call = std::move(result);
+        TailCall& tail = static_cast<TailCall&>(*call);
+        if (KindOf(tail.target) != ObjectKind::Instance) {
+            return CallMethod(tail.target, *tail.method, tail.args);
+        }
+        result = static_cast<ClassInstance&>(*tail.target).Invoke(*tail.method, tail.args);
+    }
+    return result;
+}
+
+ObjectHolder ClassInstance::Invoke(const std::string& method, const std::vector<ObjectHolder>& actual_args) {
+    return Invoke(method, _class_.GetMethod(method), actual_args);
+}
+
+template <typename Args>
+ObjectHolder ClassInstance::Invoke(const std::string& method, const Method* method_of_class, const Args& actual_args) {
+    CallStack::Scope frame(*this, method);
 
+    if (method_of_class == nullptr) {
+        throw std::runtime_error("class " + _class_.GetName() + " has no method " + method);
+    }
     if (method_of_class->formal_params.size() != actual_args.size()) {
         throw std::runtime_error("not all arguments provided");
     }
+    if (method_of_class->native) {
+        if constexpr (std::is_same_v<Args, std::vector<ObjectHolder>>) {
+            return method_of_class->native(*this, actual_args);
+        } else {
+            return method_of_class->native(*this, std::vector<ObjectHolder>(actual_args.begin(), actual_args.end()));
+        }
+    }
 
-    for (size_t i = 0; i < method_of_class->formal_params.size(); ++i){
-        fields[method_of_class->formal_params[i]] = actual_args[i];
+    auto arg = actual_args.begin();
+    for (size_t i = 0; i < method_of_class->formal_params.size(); ++i, ++arg) {
+        fields[method_of_class->formal_params[i]] = *arg;
     }
 
-    return method_of_class->body.get()->Execute(fields);
+    ObjectHolder result = method_of_class->body.get()->Execute(fields);
+    return Ast::Return::IsReturnedNone(result) ? ObjectHolder::None() : result;
 }
 
 
-Class::Class(std::string name, std::vector<Method> methods, const Class* parent) : 
-class_name(name), class_methods(std::move(methods)), class_parent(parent) {}
-const Method* Class::GetMethod(const std::string& name) const {
+Class::Class(std::string name, std::vector<Method> methods, const Class* parent, PayloadFactory payload_factory) : 
+Object(ObjectKind::Class), class_name(name), class_methods(std::move(methods)), class_parent(parent),
+payload_factory(payload_factory ? payload_factory : parent ? parent->payload_factory : nullptr) {
+    // Methods are resolved once here, so calls never walk the hierarchy.
     for (const Method& method : class_methods) {
-        if (method.name == name) {
-            return &method;
-        }
+        method_table.emplace(method.name, &method);
     }
     if (class_parent != nullptr) {
-        return class_parent->GetMethod(name);
+        method_table.insert(class_parent->method_table.begin(), class_parent->method_table.end());
     }
-
-    return nullptr;
+}
+const Method* Class::GetMethod(const std::string& name) const {
+    auto it = method_table.find(name);
+    return it != method_table.end() ? it->second : nullptr;
 }
 void Class::Print(ostream& os) { os << GetName(); }
+void Class::PrintTo(std::string& buffer) { buffer.append(GetName()); }
 const std::string& Class::GetName() const { return class_name; }
 
 
@@ -83,4 +543,6 @@ void Bool::Print(std::ostream& os) {
     else { os << "False"; }
 }
 
+void Bool::PrintTo(std::string& buffer) { AppendBool(buffer, GetValue()); }
+
 } /* namespace Runtime */
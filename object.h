@@ -1,12 +1,21 @@
 #pragma once
 
 #include "object_holder.h"
+#include "bigint.h"
+#include "hash_table.h"
+#include <any>
+#include <initializer_list>
 #include <ostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 #include <iostream>
+#include <type_traits>
+#include <atomic>
+#include <mutex>
+#include <string_view>
 
 
 namespace Ast {
@@ -17,60 +26,305 @@ class TestRunner;
 
 namespace Runtime {
 
+enum class ObjectKind : unsigned char {
+  None,
+  Bool,
+  Number,
+  BigNumber,
+  Float,
+  String,
+  List,
+  Dict,
+  Class,
+  Instance,
+  TailCall,
+  Other,
+  Count
+};
+
 class Object {
 public:
+  explicit Object(ObjectKind kind = ObjectKind::Other) : kind(kind) {}
   virtual ~Object() = default;
   virtual void Print(std::ostream& os) = 0;
+  virtual void PrintTo(std::string& buffer);
+  ObjectKind Kind() const { return kind; }
+
+private:
+  ObjectKind kind;
 };
 
+inline ObjectKind KindOf(const ObjectHolder& object) {
+  return object ? object->Kind() : ObjectKind::None;
+}
+
+template <typename T>
+constexpr ObjectKind ValueKind() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return ObjectKind::Bool;
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    return ObjectKind::Number;
+  } else if constexpr (std::is_same_v<T, BigInt>) {
+    return ObjectKind::BigNumber;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return ObjectKind::Float;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return ObjectKind::String;
+  } else {
+    return ObjectKind::Other;
+  }
+}
+
 template <typename T>
 class ValueObject : public Object {
 public:
-  ValueObject(T v) : value(v) {}
+  ValueObject(T v) : Object(ValueKind<T>()), value(v) {}
   void Print(std::ostream& os) override { os << value; }
+  void PrintTo(std::string& buffer) override { Object::PrintTo(buffer); }
   const T& GetValue() const { return value;}
   T value;
 };
 
-using String = ValueObject<std::string>;
-using Number = ValueObject<int>;
+template <>
+void ValueObject<int64_t>::PrintTo(std::string& buffer);
+template <>
+void ValueObject<BigInt>::PrintTo(std::string& buffer);
+template <>
+void ValueObject<double>::Print(std::ostream& os);
+template <>
+void ValueObject<double>::PrintTo(std::string& buffer);
+template <>
+void ValueObject<std::string>::PrintTo(std::string& buffer);
+
+using Number = ValueObject<int64_t>;
+using BigNumber = ValueObject<BigInt>;
+using Float = ValueObject<double>;
+
+class String : public ValueObject<std::string> {
+public:
+  String(std::string value) : ValueObject<std::string>(std::move(value)) {}
+  String(const String& other);
+  String(String&& other);
+
+  size_t Hash() const;
+  bool IsInterned() const { return interned; }
+
+private:
+  friend class StringPool;
+  friend bool operator==(const String& lhs, const String& rhs);
+
+  mutable std::atomic<size_t> hash{0};
+  bool interned = false;
+};
+
+bool operator==(const String& lhs, const String& rhs);
+
+inline size_t HeapBytes(const String& string) {
+  // Short strings live inside the object
+  const size_t capacity = string.GetValue().capacity();
+  return capacity > std::string().capacity() ? capacity + 1 : 0;
+}
+
+// Process-wide table of immutable strings: equal interned strings alive at
+// the same time are always the same object. The literals of a program are
+// acquired by it and leave the pool with the last program that uses them, so
+// a process that keeps parsing new versions of its scripts does not grow.
+// Strings interned for good are those of Intern and of runtime interning,
+// whose holders are not counted; runtime interning stops adding them at
+// max_runtime_strings.
+class StringPool {
+public:
+  static constexpr size_t MAX_RUNTIME_LENGTH = 16;
+  static constexpr size_t MAX_RUNTIME_STRINGS = 1 << 16;
+
+  explicit StringPool(size_t max_runtime_strings = MAX_RUNTIME_STRINGS)
+    : max_runtime_strings(max_runtime_strings) {}
+
+  // The pool used by literals and MakeString
+  static StringPool& Instance();
+
+  // Interns value until the process exits
+  String& Intern(std::string_view value);
+  // Interns value until every Acquire of it is matched by a Release
+  String& Acquire(std::string_view value);
+  void Release(String& string);
+  size_t Size() const;
+
+  // Opt-in: also intern short strings produced while running a program.
+  void SetRuntimeInterning(bool enabled) { runtime_interning = enabled; }
+  bool RuntimeInterning() const { return runtime_interning; }
+  // nullptr once max_runtime_strings strings have been interned this way
+  String* InternAtRuntime(std::string_view value);
+
+private:
+  struct Entry {
+    std::unique_ptr<String> string;
+    size_t acquired = 0;
+    bool permanent = false;
+  };
+
+  Entry& Find(std::string_view value);
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string_view, Entry> strings;
+  const size_t max_runtime_strings;
+  size_t runtime_strings = 0;
+  std::atomic<bool> runtime_interning{false};
+};
+
+ObjectHolder MakeString(std::string value);
 
 class Bool : public ValueObject<bool> {
 public:
   using ValueObject<bool>::ValueObject;
   void Print(std::ostream& os) override;
+  void PrintTo(std::string& buffer) override;
 };
 
+class ClassInstance;
+
+// C++ implementation of a method; the arguments are already checked against
+// formal_params, and the payload is reachable through self.Payload<T>()
+using NativeMethod = ObjectHolder (*)(ClassInstance& self, const std::vector<ObjectHolder>& actual_args);
+
+// Creates the initial payload of an instance of a native class
+using PayloadFactory = std::any (*)();
+
 struct Method {
   std::string name;
   std::vector<std::string> formal_params;
   std::unique_ptr<Ast::Statement> body;
+  NativeMethod native = nullptr;  // used instead of body when set
 };
 
 class Class : public Object {
 public:
-  explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
+  explicit Class(std::string name, std::vector<Method> methods, const Class* parent,
+                 PayloadFactory payload_factory = nullptr);
   const Method* GetMethod(const std::string& name) const;
   const std::string& GetName() const;
   void Print(std::ostream& os) override;
+  void PrintTo(std::string& buffer) override;
   std::string class_name;
   std::vector<Method> class_methods;
   const Class* class_parent;
+  // Own factory, or the nearest ancestor's one
+  PayloadFactory payload_factory;
+
+private:
+  std::unordered_map<std::string, const Method*> method_table;
+};
+
+class List : public Object {
+public:
+  List() : Object(ObjectKind::List) {}
+  explicit List(std::vector<ObjectHolder> items) : Object(ObjectKind::List), items(std::move(items)) {}
+  List(const List&) = default;
+  List(List&&) = default;
+  // Releases nested containers without recursing (see the definition)
+  ~List() override;
+
+  void Print(std::ostream& os) override;
+  void PrintTo(std::string& buffer) override;
+  ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args);
+
+  // Python-style index: negative values count from the end
+  size_t Position(const ObjectHolder& index) const;
+
+  std::vector<ObjectHolder>& Items() { return items; }
+  const std::vector<ObjectHolder>& Items() const { return items; }
+
+  // Charges a larger buffer, if one is needed, before adding the item
+  void Append(ObjectHolder item);
+
+private:
+  std::vector<ObjectHolder> items;
+  GrowthCharge growth;
 };
 
+// The buffer the list is created with; Append charges the ones it grows into
+inline size_t HeapBytes(const List& list) {
+  return list.Items().capacity() * sizeof(ObjectHolder);
+}
+
+class Dict : public Object {
+public:
+  Dict() : Object(ObjectKind::Dict) {}
+  Dict(const Dict&) = default;
+  Dict(Dict&&) = default;
+  ~Dict() override;
+
+  void Print(std::ostream& os) override;
+  void PrintTo(std::string& buffer) override;
+  ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args);
+
+  HashTable& Table() { return table; }
+  const HashTable& Table() const { return table; }
+
+private:
+  HashTable table;
+};
+
+// Whether item is an element of a list, a key of a dict or a substring of a string
+bool Contains(const ObjectHolder& container, const ObjectHolder& item);
+
 class ClassInstance : public Object {
 public:
   explicit ClassInstance(const Class& cls);
+  // Shallow: the copy's fields refer to the same objects as the original's
+  ClassInstance(const ClassInstance& other);
   ClassInstance (ClassInstance&& other);
+  ~ClassInstance() override;
   void Print(std::ostream& os) override;
+  void PrintTo(std::string& buffer) override;
   ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args);
+  // Calls a method already looked up in this instance's class
+  ObjectHolder Call(const Method& method, const std::vector<ObjectHolder>& actual_args);
+  // The same without building a vector of the arguments, for hosts (see
+  // MethodHandle); native methods still get one
+  ObjectHolder Call(const Method& method, std::initializer_list<ObjectHolder> actual_args);
   bool HasMethod(const std::string& method, size_t argument_count) const;
   Closure& Fields();
   const Closure& Fields() const;
   const Class& _class_;
   Closure fields;
+
+  // State of a native class kept inside the instance itself
+  template <typename T>
+  T& Payload() {
+    if (T* value = std::any_cast<T>(&payload)) {
+      return *value;
+    }
+    throw std::runtime_error("instance of " + _class_.GetName() + " has no payload of the requested type");
+  }
+
+private:
+  std::any payload;
+
+  // Runs the method body once; the result may be a pending TailCall
+  ObjectHolder Invoke(const std::string& method, const std::vector<ObjectHolder>& actual_args);
+  template <typename Args>
+  ObjectHolder Invoke(const std::string& method, const Method* method_of_class, const Args& actual_args);
+  // Makes the calls a method returned as TailCalls until one returns a value
+  static ObjectHolder FinishTailCalls(ObjectHolder result);
 };
 
+// Result of `return obj.method(...)` inside a method. The call is made by
+// ClassInstance::Call after the returning method's frame is gone, so chains
+// of tail calls run in constant native stack space.
+class TailCall : public Object {
+public:
+  TailCall(ObjectHolder target, const std::string& method, std::vector<ObjectHolder> args);
+  void Print(std::ostream& os) override;
+
+  ObjectHolder target;
+  const std::string* method;  // owned by the calling statement
+  std::vector<ObjectHolder> args;
+};
+
+// Calls a method of an instance, list or dict
+ObjectHolder CallMethod(ObjectHolder& target, const std::string& method, const std::vector<ObjectHolder>& actual_args);
+
 void RunObjectsTests(TestRunner& test_runner);
 void PrintClosure(const Closure& closure);
 
@@ -4,58 +4,32 @@
 namespace Runtime {
 
 ObjectHolder ObjectHolder::Share(Object& object) {
-  return ObjectHolder(std::shared_ptr<Object>(&object, [](auto*) { /* do nothing */ }));
-}
-
-ObjectHolder ObjectHolder::None() {
-  return ObjectHolder();
-}
-
-Object& ObjectHolder::operator *() {
-  return *Get();
-}
-
-const Object& ObjectHolder::operator *() const {
-  return *Get();
-}
-
-Object* ObjectHolder::operator ->() {
-  return Get();
-}
-
-const Object* ObjectHolder::operator ->() const {
-  return Get();
-}
-
-Object* ObjectHolder::Get() {
-  return data.get();
-}
-
-const Object* ObjectHolder::Get() const {
-  return data.get();
-}
-
-ObjectHolder::operator bool() const {
-  return Get();
+  // Aliasing an empty owner: no control block is allocated and no reference
+  // count is ever touched for non-owned objects.
+  return ObjectHolder(std::shared_ptr<Object>(std::shared_ptr<Object>(), &object));
 }
 
 bool IsTrue(ObjectHolder object) {
-  if (!object.Get()) {
-    return false;
-  }
-  if (auto bool_value = object.TryAs<Bool>()) {
-    return bool_value->GetValue();
-  }
-  if (auto nubmer_value = object.TryAs<Number>()) {
-    return nubmer_value->GetValue() != 0;
-  }
-  if (auto string_value = object.TryAs<String>()) {
-    return string_value->GetValue() != "";
-  }
-  if (auto object_value = object.TryAs<ClassInstance>()) {
-    return true;
+  switch (KindOf(object)) {
+    case ObjectKind::Bool:
+      return static_cast<const Bool&>(*object).GetValue();
+    case ObjectKind::Number:
+      return static_cast<const Number&>(*object).GetValue() != 0;
+    case ObjectKind::BigNumber:
+      return !static_cast<const BigNumber&>(*object).GetValue().IsZero();
+    case ObjectKind::Float:
+      return static_cast<const Float&>(*object).GetValue() != 0;
+    case ObjectKind::String:
+      return static_cast<const String&>(*object).GetValue() != "";
+    case ObjectKind::List:
+      return !static_cast<const List&>(*object).Items().empty();
+    case ObjectKind::Dict:
+      return static_cast<const Dict&>(*object).Table().Size() != 0;
+    case ObjectKind::Instance:
+      return true;
+    default:
+      return false;
   }
-  return false;
 }
 
 }
@@ -1,6 +1,11 @@
 #pragma once
 
+#include "memory.h"
+
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
 
 class TestRunner;
@@ -9,27 +14,35 @@ namespace Runtime {
 
 class Object;
 
+// Heap memory an object owns besides itself, charged to its interpreter along
+// with the object. Types that own any overload this next to their definition.
+inline size_t HeapBytes(const Object&) { return 0; }
+
 class ObjectHolder {
 public:
   ObjectHolder() = default;
 
+  // Objects created while an interpreter runs are charged to its memory
+  // account (see MemoryAccount). Small ones come from the BlockCache either way.
   template <typename T>
   static ObjectHolder Own(T&& object) {
-    return ObjectHolder(
-      std::make_shared<T>(std::forward<T>(object))
-    );
+    return ObjectHolder(std::allocate_shared<T>(
+      AccountedAllocator<T>(MemoryAccount::Current(), HeapBytes(object)), std::forward<T>(object)
+    ));
   }
 
   static ObjectHolder Share(Object& object);
-  static ObjectHolder None();
+  static ObjectHolder None() { return ObjectHolder(); }
 
-  Object& operator*();
-  const Object& operator*() const;
-  Object* operator->();
-  const Object* operator->() const;
+  // Defined here rather than in object_holder.cpp: they are on every step of
+  // the interpreter and must be inlined into it
+  Object& operator*() { return *Get(); }
+  const Object& operator*() const { return *Get(); }
+  Object* operator->() { return Get(); }
+  const Object* operator->() const { return Get(); }
 
-  Object* Get();
-  const Object* Get() const;
+  Object* Get() { return data.get(); }
+  const Object* Get() const { return data.get(); }
 
   template <typename T>
   T* TryAs() {
@@ -41,14 +54,99 @@ public:
     return dynamic_cast<const T*>(this->Get());
   }
 
-  explicit operator bool() const;
+  explicit operator bool() const { return Get() != nullptr; }
+
+  // True if this handle is the only owner of the object. Non-owning handles
+  // (see Share) never count as unique.
+  bool IsUnique() const { return data.use_count() == 1; }
+  // True if this handle and other are the only two owners of the object
+  bool IsSharedOnlyWith(const ObjectHolder& other) const {
+    return data == other.data && data.use_count() == 2;
+  }
+  // False for the handles made by Share and for None
+  bool IsOwning() const { return data.use_count() != 0; }
 
 private:
   ObjectHolder(std::shared_ptr<Object> data) : data(std::move(data)) {}
   std::shared_ptr<Object> data;
 };
 
-using Closure = std::unordered_map<std::string, ObjectHolder>;
+// The variables of a scope: the globals, or the fields of an instance. Beyond
+// the map itself, it lets statements skip hashing the names they look up
+// again and again, such as the variables of a loop body (see Slot).
+class Closure : public std::unordered_map<std::string, ObjectHolder> {
+  using Base = std::unordered_map<std::string, ObjectHolder>;
+
+public:
+  using Base::Base;
+  Closure() = default;
+  Closure(const Closure& other) : Base(other) {}
+  Closure(Closure&& other) : Base(std::move(other)) { other.Invalidate(); }
+  Closure& operator=(const Closure& other) {
+    Base::operator=(other);
+    Invalidate();
+    return *this;
+  }
+  Closure& operator=(Closure&& other) {
+    Base::operator=(std::move(other));
+    Invalidate();
+    other.Invalidate();
+    return *this;
+  }
+
+  // Everything that can remove a variable forgets the remembered slots
+  template <typename... Args>
+  auto erase(Args&&... args) {
+    Invalidate();
+    return Base::erase(std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  auto extract(Args&&... args) {
+    Invalidate();
+    return Base::extract(std::forward<Args>(args)...);
+  }
+  void clear() noexcept {
+    Invalidate();
+    Base::clear();
+  }
+  void swap(Closure& other) {
+    Base::swap(other);
+    Invalidate();
+    other.Invalidate();
+  }
+
+  // The value of name, or nullptr if it is not defined. site stands for the
+  // statement asking: where it found name is remembered per thread, and
+  // trusted while no variable of this closure has been removed and the
+  // variable there still has that name.
+  ObjectHolder* Slot(const void* site, const std::string& name) {
+    SlotCacheEntry& entry = slot_cache[(reinterpret_cast<uintptr_t>(site) / alignof(void*) ^ id) % SLOT_CACHE_SIZE];
+    if (entry.closure == id && entry.variable->first == name) {
+      return &entry.variable->second;
+    }
+    const auto it = find(name);
+    if (it == end()) {
+      return nullptr;
+    }
+    entry = {id, &*it};
+    return &it->second;
+  }
+
+private:
+  struct SlotCacheEntry {
+    uint64_t closure;
+    value_type* variable;
+  };
+  static constexpr size_t SLOT_CACHE_SIZE = 256;
+  static inline thread_local SlotCacheEntry slot_cache[SLOT_CACHE_SIZE] = {};
+  // Ids are never reused, so a closure that happens to get the address of a
+  // destroyed one cannot pick up its slots
+  static inline std::atomic<uint64_t> next_id{1};
+
+  void Invalidate() { id = next_id.fetch_add(1, std::memory_order_relaxed); }
+
+  uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+};
 
 bool IsTrue(ObjectHolder object);
 
@@ -27,6 +27,54 @@ void TestString() {
   ASSERT_EQUAL(word.GetValue(), "hello!");
 }
 
+void TestStringInterning() {
+  StringPool& pool = StringPool::Instance();
+
+  String& hello = pool.Intern("interning test: hello");
+  ASSERT(hello.IsInterned());
+  ASSERT(&pool.Intern("interning test: hello") == &hello);
+  ASSERT(!(pool.Intern("interning test: world") == hello));
+
+  String copy("interning test: hello");
+  ASSERT(!copy.IsInterned());
+  ASSERT(copy == hello);
+  ASSERT_EQUAL(copy.Hash(), hello.Hash());
+  ASSERT(!(String("interning test: hellO") == hello));
+
+  const size_t size = pool.Size();
+  {
+    Ast::StringConst first(String("interning test: literal"));
+    Ast::StringConst second(String("interning test: literal"));
+    Closure closure;
+    ASSERT(first.Execute(closure).Get() == second.Execute(closure).Get());
+    ASSERT_EQUAL(pool.Size(), size + 1);
+  }
+  // Literals leave the pool with the last statement that holds them
+  ASSERT_EQUAL(pool.Size(), size);
+  {
+    Ast::StringConst literal(String("interning test: hello"));
+    ASSERT(&literal.value == &hello);
+  }
+  ASSERT(&pool.Intern("interning test: hello") == &hello);
+
+  ASSERT(!MakeString("short").TryAs<String>()->IsInterned());
+  pool.SetRuntimeInterning(true);
+  ASSERT(MakeString("short").TryAs<String>()->IsInterned());
+  ASSERT(!MakeString(string(StringPool::MAX_RUNTIME_LENGTH + 1, 'x')).TryAs<String>()->IsInterned());
+  pool.SetRuntimeInterning(false);
+
+  // Runtime interning stops at its limit, but keeps finding what it interned.
+  // A pool of its own, so that the shared one is not left full.
+  StringPool small(3);
+  String* first = small.InternAtRuntime("rt0");
+  ASSERT(first && first->IsInterned());
+  ASSERT(small.InternAtRuntime("rt1"));
+  ASSERT(small.InternAtRuntime("rt2"));
+  ASSERT(!small.InternAtRuntime("rt-over-limit"));
+  ASSERT(small.InternAtRuntime("rt0") == first);
+  ASSERT_EQUAL(small.Size(), 3u);
+}
+
 void TestFields() {
   vector<Method> methods;
 
@@ -140,6 +188,7 @@ void TestInheritance() {
 void RunObjectsTests(TestRunner& tr) {
   RUN_TEST(tr, Runtime::TestNumber);
   RUN_TEST(tr, Runtime::TestString);
+  RUN_TEST(tr, Runtime::TestStringInterning);
   RUN_TEST(tr, Runtime::TestFields);
   RUN_TEST(tr, Runtime::TestBaseClass);
   RUN_TEST(tr, Runtime::TestInheritance);
@@ -0,0 +1,112 @@
+#include "output_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace Runtime {
+
+void OutputSink::WriteV(const std::string_view* parts, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    Write(parts[i]);
+  }
+}
+
+void StreamSink::Write(std::string_view data) {
+  os->write(data.data(), data.size());
+}
+
+void StreamSink::Flush() {
+  os->flush();
+}
+
+FdSink::FdSink(int fd, FlushPolicy policy, size_t capacity)
+  : fd(fd), policy(policy), capacity(capacity)
+{
+  buffer.reserve(capacity);
+}
+
+FdSink::~FdSink() {
+  try {
+    Flush();
+  } catch (...) {
+  }
+}
+
+void FdSink::Write(std::string_view data) {
+  WriteV(&data, 1);
+}
+
+void FdSink::WriteV(const std::string_view* parts, size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    total += parts[i].size();
+  }
+
+  if (policy != FlushPolicy::OnExit && buffer.size() + total > capacity) {
+    // Too big to stage: send what is buffered together with the new parts
+    // in a single writev instead of copying them through the buffer.
+    std::vector<std::string_view> batch;
+    batch.reserve(count + 1);
+    batch.push_back(buffer);
+    batch.insert(batch.end(), parts, parts + count);
+    WriteAll(batch.data(), batch.size());
+    buffer.clear();
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    buffer.append(parts[i]);
+  }
+  if (policy == FlushPolicy::OnNewline && !buffer.empty() && buffer.back() == '\n') {
+    Flush();
+  }
+}
+
+void FdSink::Flush() {
+  if (buffer.empty()) {
+    return;
+  }
+  std::string_view pending = buffer;
+  WriteAll(&pending, 1);
+  buffer.clear();
+}
+
+void FdSink::WriteAll(const std::string_view* parts, size_t count) {
+  std::vector<iovec> iov;
+  iov.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (!parts[i].empty()) {
+      iov.push_back({const_cast<char*>(parts[i].data()), parts[i].size()});
+    }
+  }
+
+  size_t first = 0;
+  while (first < iov.size()) {
+    size_t batch = std::min<size_t>(iov.size() - first, IOV_MAX);
+    ssize_t written = writev(fd, iov.data() + first, static_cast<int>(batch));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("failed to write program output");
+    }
+    size_t left = static_cast<size_t>(written);
+    while (first < iov.size() && left >= iov[first].iov_len) {
+      left -= iov[first].iov_len;
+      ++first;
+    }
+    if (left > 0) {
+      iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+      iov[first].iov_len -= left;
+    }
+  }
+}
+
+} /* namespace Runtime */
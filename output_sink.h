@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+class TestRunner;
+
+namespace Runtime {
+
+class OutputSink {
+public:
+  virtual ~OutputSink() = default;
+  virtual void Write(std::string_view data) = 0;
+  virtual void WriteV(const std::string_view* parts, size_t count);
+  virtual void Flush() = 0;
+};
+
+class StreamSink : public OutputSink {
+public:
+  explicit StreamSink(std::ostream& os) : os(&os) {}
+  void SetStream(std::ostream& output_stream) { os = &output_stream; }
+  void Write(std::string_view data) override;
+  void Flush() override;
+
+private:
+  std::ostream* os;
+};
+
+enum class FlushPolicy {
+  OnExit,     // keep everything in memory until Flush() or destruction
+  OnSize,     // write out whenever the buffer fills up
+  OnNewline,  // write out after every completed line, for interactive use
+};
+
+class FdSink : public OutputSink {
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+  explicit FdSink(int fd, FlushPolicy policy = FlushPolicy::OnSize, size_t capacity = DEFAULT_CAPACITY);
+  FdSink(const FdSink&) = delete;
+  FdSink& operator=(const FdSink&) = delete;
+  ~FdSink() override;
+
+  void Write(std::string_view data) override;
+  void WriteV(const std::string_view* parts, size_t count) override;
+  void Flush() override;
+
+  size_t Buffered() const { return buffer.size(); }
+
+private:
+  void WriteAll(const std::string_view* parts, size_t count);
+
+  int fd;
+  FlushPolicy policy;
+  size_t capacity;
+  std::string buffer;
+};
+
+void RunOutputSinkTests(TestRunner& tr);
+
+} /* namespace Runtime */
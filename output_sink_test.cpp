@@ -0,0 +1,92 @@
+#include "output_sink.h"
+
+#include "test_runner.h"
+
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+struct Pipe {
+  int read_end = -1;
+  int write_end = -1;
+
+  Pipe() {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      throw runtime_error("pipe() failed");
+    }
+    read_end = fds[0];
+    write_end = fds[1];
+    fcntl(read_end, F_SETFL, O_NONBLOCK);
+  }
+
+  ~Pipe() {
+    close(read_end);
+    close(write_end);
+  }
+
+  string ReadAvailable() const {
+    string result;
+    char chunk[256];
+    ssize_t n;
+    while ((n = read(read_end, chunk, sizeof(chunk))) > 0) {
+      result.append(chunk, n);
+    }
+    return result;
+  }
+};
+
+}
+
+void TestFdSinkFlushOnSize() {
+  Pipe p;
+  FdSink sink(p.write_end, FlushPolicy::OnSize, 8);
+
+  sink.Write("abc\n");
+  ASSERT_EQUAL(p.ReadAvailable(), "");
+  ASSERT_EQUAL(sink.Buffered(), 4u);
+
+  sink.Write("defgh\n");
+  ASSERT_EQUAL(p.ReadAvailable(), "abc\ndefgh\n");
+  ASSERT_EQUAL(sink.Buffered(), 0u);
+
+  sink.Write("xy");
+  sink.Flush();
+  ASSERT_EQUAL(p.ReadAvailable(), "xy");
+}
+
+void TestFdSinkFlushOnNewline() {
+  Pipe p;
+  FdSink sink(p.write_end, FlushPolicy::OnNewline);
+
+  sink.Write("partial");
+  ASSERT_EQUAL(p.ReadAvailable(), "");
+  sink.Write(" line\n");
+  ASSERT_EQUAL(p.ReadAvailable(), "partial line\n");
+}
+
+void TestFdSinkFlushOnExit() {
+  Pipe p;
+  {
+    FdSink sink(p.write_end, FlushPolicy::OnExit, 4);
+    string_view parts[] = {"one ", "two ", "three\n"};
+    sink.WriteV(parts, 3);
+    ASSERT_EQUAL(p.ReadAvailable(), "");
+  }
+  ASSERT_EQUAL(p.ReadAvailable(), "one two three\n");
+}
+
+void RunOutputSinkTests(TestRunner& tr) {
+  RUN_TEST(tr, TestFdSinkFlushOnSize);
+  RUN_TEST(tr, TestFdSinkFlushOnNewline);
+  RUN_TEST(tr, TestFdSinkFlushOnExit);
+}
+
+} /* namespace Runtime */
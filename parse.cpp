@@ -2,12 +2,16 @@
 #include "statement.h"
 #include "lexer.h" //         Mython
 #include "comparators.h"
+#include "native_class.h"
 
 #include <algorithm>
 #include <string>
 #include <cctype>
+#include <cstdint>
 #include <vector>
+#include <mutex>
 #include <optional>
+#include <utility>
 
 using namespace std;
 
@@ -25,9 +29,58 @@ bool operator != (const Parse::Token& token, char c) {
 
 }
 
+namespace {
+string DescribeArity(const Runtime::Builtin& builtin) {
+  if (builtin.min_args == builtin.max_args) {
+    return builtin.min_args == 1 ? "exactly one argument" : "exactly " + to_string(builtin.min_args) + " arguments";
+  }
+  if (builtin.max_args == SIZE_MAX) {
+    return "at least " + to_string(builtin.min_args) + (builtin.min_args == 1 ? " argument" : " arguments");
+  }
+  return "from " + to_string(builtin.min_args) + " to " + to_string(builtin.max_args) + " arguments";
+}
+}
+
+// Classes that calls in a deferred method body named when it was pre-parsed
+using ClassBindings = vector<pair<string, const Runtime::Class*>>;
+
+// A method body pre-parsed under ParseOptions::lazy_method_bodies: its tokens
+// and nothing else until it first runs. It is parsed once even if several
+// threads run it at the same time; a body that fails to parse throws
+// ParseError on every call.
+class LazyMethodBody : public Ast::Statement {
+public:
+  LazyMethodBody(vector<Parse::Token> tokens, ClassBindings classes)
+    : tokens(std::move(tokens)), classes(std::move(classes)) {}
+
+  ObjectHolder Execute(Runtime::Closure& closure) const override {
+    return Body().Execute(closure);
+  }
+
+private:
+  const Ast::Statement& Body() const;
+
+  mutable once_flag parsed;
+  mutable unique_ptr<Ast::Statement> body;
+  mutable vector<Parse::Token> tokens;  // released once parsed
+  ClassBindings classes;
+};
+
 class Parser {
 public:
-  explicit Parser(Parse::Lexer& lexer) : lexer(lexer) {
+  Parser(Parse::Lexer& lexer, ParseOptions options) : lexer(lexer), options(options) {
+  }
+
+  // Parses a deferred method body, with classes standing in for the classes
+  // declared at the time
+  Parser(Parse::Lexer& lexer, const ClassBindings& classes) : lexer(lexer), bound_classes(&classes) {
+    in_method = true;
+  }
+
+  unique_ptr<Ast::Statement> ParseMethodBody() {
+    auto result = ParseSuite();
+    lexer.Expect<TokenType::Eof>();
+    return result;
   }
 
   // Program -> eps
@@ -43,7 +96,27 @@ public:
 
 private:
   Parse::Lexer& lexer;
+  ParseOptions options;
   Runtime::Closure declared_classes;
+  const ClassBindings* bound_classes = nullptr;
+  int loop_depth = 0;
+  bool in_method = false;
+
+  // Classes of the script shadow the registered native ones
+  const Runtime::Class* FindClass(const string& name) const {
+    if (bound_classes) {
+      for (const auto& [bound_name, cls] : *bound_classes) {
+        if (bound_name == name) {
+          return cls;
+        }
+      }
+      return nullptr;
+    }
+    if (auto it = declared_classes.find(name); it != declared_classes.end()) {
+      return static_cast<const Runtime::Class*>(it->second.Get());
+    }
+    return Runtime::NativeClassRegistry::Instance().Find(name);
+  }
 
   // Suite -> NEWLINE INDENT (Statement)+ DEDENT
   unique_ptr<Ast::Statement> ParseSuite() {
@@ -84,13 +157,88 @@ private:
       lexer.ExpectNext<TokenType::Char>(':');
       lexer.NextToken();
 
-      m.body = ParseSuite();
+      if (options.lazy_method_bodies) {
+        m.body = PreParseSuite();
+      } else {
+        // break and continue inside a method never refer to loops around the class
+        const int outer_loop_depth = std::exchange(loop_depth, 0);
+        const bool outer_in_method = std::exchange(in_method, true);
+        m.body = ParseSuite();
+        in_method = outer_in_method;
+        loop_depth = outer_loop_depth;
+      }
 
       result.push_back(std::move(m));
     }
     return result;
   }
 
+  // Collects the tokens of a method body, checking only its indentation and
+  // brackets, and leaves the rest to the first call
+  unique_ptr<Ast::Statement> PreParseSuite() {
+    lexer.Expect<TokenType::Newline>();
+    vector<Parse::Token> tokens{lexer.CurrentToken()};
+    lexer.ExpectNext<TokenType::Indent>();
+
+    string open_brackets;
+    bool defines_class = false;
+    int depth = 0;
+    do {
+      const Parse::Token& token = lexer.CurrentToken();
+      if (token.Is<TokenType::Indent>()) {
+        ++depth;
+      } else if (token.Is<TokenType::Dedent>()) {
+        --depth;
+      } else if (token.Is<TokenType::Eof>()) {
+        throw ParseError("Unexpected end of file in a method body");
+      } else if (token.Is<TokenType::Class>()) {
+        defines_class = true;
+      } else if (token == '(' || token == '[' || token == '{') {
+        open_brackets.push_back(token.As<TokenType::Char>().value);
+      } else if (token == ')' || token == ']' || token == '}') {
+        const char close = token.As<TokenType::Char>().value;
+        const char open = close == ')' ? '(' : close == ']' ? '[' : '{';
+        if (open_brackets.empty() || open_brackets.back() != open) {
+          throw ParseError(string("Unbalanced '") + close + "' in a method body");
+        }
+        open_brackets.pop_back();
+      }
+      tokens.push_back(token);
+      lexer.NextToken();
+    } while (depth > 0);
+    if (!open_brackets.empty()) {
+      throw ParseError(string("Unclosed '") + open_brackets.back() + "' in a method body");
+    }
+
+    ClassBindings classes;
+    for (size_t i = 0; i + 1 < tokens.size(); ++i) {
+      auto id = tokens[i].TryAs<TokenType::Id>();
+      if (!id || tokens[i + 1] != '(' || (i > 0 && tokens[i - 1] == '.')) {
+        continue;
+      }
+      const Runtime::Class* cls = FindClass(id->value);
+      const bool known = any_of(classes.begin(), classes.end(), [&id](const auto& binding) {
+        return binding.first == id->value;
+      });
+      if (cls && !known) {
+        classes.emplace_back(id->value, cls);
+      }
+    }
+
+    if (defines_class) {
+      // The class would be declared for the code after the method, so it
+      // has to be parsed now, against the classes declared so far
+      Parse::Lexer replay(std::move(tokens));
+      Parser nested(replay, options);
+      nested.in_method = true;
+      nested.declared_classes = std::move(declared_classes);
+      auto body = nested.ParseMethodBody();
+      declared_classes = std::move(nested.declared_classes);
+      return body;
+    }
+    return make_unique<LazyMethodBody>(std::move(tokens), std::move(classes));
+  }
+
   // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
   unique_ptr<Ast::Statement> ParseClassDefinition() {
     string class_name = lexer.Expect<TokenType::Id>().value;
@@ -103,10 +251,9 @@ private:
       lexer.ExpectNext<TokenType::Char>(')');
       lexer.NextToken();
 
-      if (auto it = declared_classes.find(name); it == declared_classes.end()) {
+      base_class = FindClass(name);
+      if (!base_class) {
         throw ParseError("Base class " + name + " not found for class " + class_name);
-      } else {
-        base_class = static_cast<const Runtime::Class*>(it->second.Get());
       }
     }
 
@@ -142,11 +289,15 @@ private:
   }
 
   //  AssgnOrCall -> DottedIds = Expr
+  //               | DottedIds ['[' Expr ']']+ = Expr
   //               | DottedIds '(' ExprList ')'
   unique_ptr<Ast::Statement> ParseAssignmentOrCall() {
     lexer.Expect<TokenType::Id>();
 
     vector<string> id_list = ParseDottedIds();
+    if (lexer.CurrentToken() == '[') {
+      return ParseIndexAssignment(make_unique<Ast::VariableValue>(std::move(id_list)));
+    }
     string last_name = id_list.back();
     id_list.pop_back();
 
@@ -184,6 +335,24 @@ private:
     }
   }
 
+  unique_ptr<Ast::Statement> ParseIndexAssignment(unique_ptr<Ast::Statement> object) {
+    while (true) {
+      lexer.Expect<TokenType::Char>('[');
+      lexer.NextToken();
+      auto index = ParseTest();
+      lexer.Expect<TokenType::Char>(']');
+
+      if (lexer.NextToken() == '[') {
+        object = make_unique<Ast::Index>(std::move(object), std::move(index));
+        continue;
+      }
+
+      lexer.Expect<TokenType::Char>('=');
+      lexer.NextToken();
+      return make_unique<Ast::IndexAssignment>(std::move(object), std::move(index), ParseTest());
+    }
+  }
+
   // Expr -> Adder ['+'/'-' Adder]*
   unique_ptr<Ast::Statement> ParseExpression() {
     unique_ptr<Ast::Statement> result = ParseAdder();
@@ -216,8 +385,68 @@ private:
     return result;
   }
 
-  // Mult -> '(' Expr ')'
+  // Mult -> Atom ['[' Subscript ']']*
+  unique_ptr<Ast::Statement> ParseMult() {
+    auto result = ParseAtom();
+    while (lexer.CurrentToken() == '[') {
+      result = ParseSubscript(std::move(result));
+    }
+    return result;
+  }
+
+  // Subscript -> Expr
+  //            | [Expr] ':' [Expr]
+  unique_ptr<Ast::Statement> ParseSubscript(unique_ptr<Ast::Statement> object) {
+    lexer.Expect<TokenType::Char>('[');
+    lexer.NextToken();
+
+    unique_ptr<Ast::Statement> begin;
+    if (lexer.CurrentToken() != ':') {
+      begin = ParseTest();
+    }
+
+    if (lexer.CurrentToken() == ':') {
+      unique_ptr<Ast::Statement> end;
+      if (lexer.NextToken() != ']') {
+        end = ParseTest();
+      }
+      lexer.Expect<TokenType::Char>(']');
+      lexer.NextToken();
+      return make_unique<Ast::Slice>(std::move(object), std::move(begin), std::move(end));
+    }
+
+    lexer.Expect<TokenType::Char>(']');
+    lexer.NextToken();
+    return make_unique<Ast::Index>(std::move(object), std::move(begin));
+  }
+
+  // DictLiteral -> '{' [Expr ':' Expr [',' Expr ':' Expr]*] '}'
+  unique_ptr<Ast::Statement> ParseDictLiteral() {
+    lexer.Expect<TokenType::Char>('{');
+    vector<pair<unique_ptr<Ast::Statement>, unique_ptr<Ast::Statement>>> items;
+    if (lexer.NextToken() != '}') {
+      while (true) {
+        auto key = ParseTest();
+        lexer.Expect<TokenType::Char>(':');
+        lexer.NextToken();
+        items.emplace_back(std::move(key), ParseTest());
+        if (lexer.CurrentToken() != ',') {
+          break;
+        }
+        lexer.NextToken();
+      }
+    }
+    lexer.Expect<TokenType::Char>('}');
+    lexer.NextToken();
+    return make_unique<Ast::DictLiteral>(std::move(items));
+  }
+
+  // Atom -> '(' Expr ')'
+  //       | '[' [ExprList] ']'
+  //       | DictLiteral
   //       | NUMBER
+  //       | LONG_NUMBER
+  //       | FLOAT
   //       | '-' Mult
   //       | STRING
   //       | NONE
@@ -225,13 +454,23 @@ private:
   //       | FALSE
   //       | DottedIds '(' ExprList ')'
   //       | DottedIds
-  unique_ptr<Ast::Statement> ParseMult() {
+  unique_ptr<Ast::Statement> ParseAtom() {
     if (lexer.CurrentToken() == '(') {
       lexer.NextToken();
       auto result = ParseTest();
       lexer.Expect<TokenType::Char>(')');
       lexer.NextToken();
       return result;
+    } else if (lexer.CurrentToken() == '[') {
+      vector<unique_ptr<Ast::Statement>> items;
+      if (lexer.NextToken() != ']') {
+        items = ParseTestList();
+      }
+      lexer.Expect<TokenType::Char>(']');
+      lexer.NextToken();
+      return make_unique<Ast::ListLiteral>(std::move(items));
+    } else if (lexer.CurrentToken() == '{') {
+      return ParseDictLiteral();
     } else if (lexer.CurrentToken() == '-') {
       lexer.NextToken();
       return make_unique<Ast::Mult>(
@@ -239,9 +478,17 @@ private:
         make_unique<Ast::NumericConst>(-1)
       );
     } else if (auto num = lexer.CurrentToken().TryAs<TokenType::Number>()) {
-      int result = num->value;
+      int64_t result = num->value;
       lexer.NextToken();
       return make_unique<Ast::NumericConst>(result);
+    } else if (auto num = lexer.CurrentToken().TryAs<TokenType::LongNumber>()) {
+      auto result = Runtime::BigInt::Parse(num->value);
+      lexer.NextToken();
+      return make_unique<Ast::BigNumericConst>(std::move(*result));
+    } else if (auto num = lexer.CurrentToken().TryAs<TokenType::Float>()) {
+      double result = num->value;
+      lexer.NextToken();
+      return make_unique<Ast::FloatConst>(result);
     } else if (auto str = lexer.CurrentToken().TryAs<TokenType::String>()) {
       string result = str->value;
       lexer.NextToken();
@@ -276,15 +523,22 @@ private:
             std::move(method_name),
             std::move(args)
           );
-        } else if (auto it = declared_classes.find(method_name); it != end(declared_classes)) {
-          return make_unique<Ast::NewInstance>(
-            static_cast<const Runtime::Class&>(*it->second), std::move(args)
-          );
-        } else if (method_name == "str") {
-          if (args.size() != 1) {
-            throw ParseError("Function str takes exactly one argument");
+        } else if (auto cls = FindClass(method_name)) {
+          return make_unique<Ast::NewInstance>(*cls, std::move(args));
+        } else if (auto builtin = Runtime::BuiltinRegistry::Instance().Find(method_name)) {
+          if (args.size() < builtin->min_args || args.size() > builtin->max_args) {
+            throw ParseError("Function " + method_name + " takes " + DescribeArity(*builtin));
+          }
+          return make_unique<Ast::BuiltinCall>(*builtin, std::move(args));
+        } else if (method_name == "range") {
+          if (args.empty() || args.size() > 3) {
+            throw ParseError("Function range takes from one to three arguments");
           }
-          return make_unique<Ast::Stringify>(std::move(args.front()));
+          if (args.size() == 1) {
+            return make_unique<Ast::Range>(nullptr, std::move(args[0]), nullptr);
+          }
+          args.resize(3);
+          return make_unique<Ast::Range>(std::move(args[0]), std::move(args[1]), std::move(args[2]));
         } else {
           throw ParseError("Unknown call to " + method_name + "()");
         }
@@ -327,6 +581,41 @@ private:
     return make_unique<Ast::IfElse>(std::move(condition), std::move(if_body), std::move(else_body));
   }
 
+  // Loop body -> Suite, with break and continue allowed inside
+  unique_ptr<Ast::Statement> ParseLoopBody() {
+    lexer.Expect<TokenType::Char>(':');
+    lexer.NextToken();
+    ++loop_depth;
+    auto body = ParseSuite();
+    --loop_depth;
+    return body;
+  }
+
+  // WhileLoop -> while LogicalExpr: Suite
+  unique_ptr<Ast::Statement> ParseWhile() {
+    lexer.Expect<TokenType::While>();
+    lexer.NextToken();
+
+    auto condition = ParseTest();
+    return make_unique<Ast::While>(std::move(condition), ParseLoopBody());
+  }
+
+  // ForLoop -> for id in LogicalExpr: Suite
+  unique_ptr<Ast::Statement> ParseFor() {
+    lexer.Expect<TokenType::For>();
+    string variable = lexer.ExpectNext<TokenType::Id>().value;
+    lexer.ExpectNext<TokenType::In>();
+    lexer.NextToken();
+
+    auto iterable = ParseTest();
+    auto body = ParseLoopBody();
+    if (dynamic_cast<Ast::Range*>(iterable.get())) {
+      unique_ptr<Ast::Range> range(static_cast<Ast::Range*>(iterable.release()));
+      return make_unique<Ast::RangeFor>(std::move(variable), std::move(range), std::move(body));
+    }
+    return make_unique<Ast::ForIn>(std::move(variable), std::move(iterable), std::move(body));
+  }
+
   // LogicalExpr -> AndTest [OR AndTest]
   // AndTest -> NotTest [AND NotTest]
   // NotTest -> [NOT] NotTest
@@ -359,6 +648,7 @@ private:
   }
 
   // Comparison -> Expr [COMP_OP Expr]
+  //             | Expr IN Expr
   unique_ptr<Ast::Statement> ParseComparison() {
     auto result = ParseExpression();
 
@@ -366,22 +656,25 @@ private:
 
     if (tok == '<') {
       lexer.NextToken();
-      return make_unique<Ast::Comparison>(Runtime::Less, std::move(result), ParseExpression());
+      return make_unique<Ast::Comparison>(Runtime::CompareOp::Less, std::move(result), ParseExpression());
     } else if (tok == '>') {
       lexer.NextToken();
-      return make_unique<Ast::Comparison>(Runtime::Greater, std::move(result), ParseExpression());
+      return make_unique<Ast::Comparison>(Runtime::CompareOp::Greater, std::move(result), ParseExpression());
     } else if (tok.Is<TokenType::Eq>()) {
       lexer.NextToken();
-      return make_unique<Ast::Comparison>(Runtime::Equal, std::move(result), ParseExpression());
+      return make_unique<Ast::Comparison>(Runtime::CompareOp::Equal, std::move(result), ParseExpression());
     } else if (tok.Is<TokenType::NotEq>()) {
       lexer.NextToken();
-      return make_unique<Ast::Comparison>(Runtime::NotEqual, std::move(result), ParseExpression());
+      return make_unique<Ast::Comparison>(Runtime::CompareOp::NotEqual, std::move(result), ParseExpression());
     } else if (tok.Is<TokenType::LessOrEq>()) {
       lexer.NextToken();
-      return make_unique<Ast::Comparison>(Runtime::LessOrEqual, std::move(result), ParseExpression());
+      return make_unique<Ast::Comparison>(Runtime::CompareOp::LessOrEqual, std::move(result), ParseExpression());
     } else if (tok.Is<TokenType::GreaterOrEq>()) {
       lexer.NextToken();
-      return make_unique<Ast::Comparison>(Runtime::GreaterOrEqual, std::move(result), ParseExpression());
+      return make_unique<Ast::Comparison>(Runtime::CompareOp::GreaterOrEqual, std::move(result), ParseExpression());
+    } else if (tok.Is<TokenType::In>()) {
+      lexer.NextToken();
+      return make_unique<Ast::Membership>(std::move(result), ParseExpression());
     } else {
       return result;
     }
@@ -390,6 +683,8 @@ private:
   //Statement -> SimpleStatement Newline
   //           | class ClassDefinition
   //           | if Condition
+  //           | while WhileLoop
+  //           | for ForLoop
   unique_ptr<Ast::Statement> ParseStatement() {
     const auto& tok = lexer.CurrentToken();
 
@@ -398,6 +693,10 @@ private:
       return ParseClassDefinition();
     } else if (tok.Is<TokenType::If>()) {
       return ParseCondition();
+    } else if (tok.Is<TokenType::While>()) {
+      return ParseWhile();
+    } else if (tok.Is<TokenType::For>()) {
+      return ParseFor();
     } else {
       auto result = ParseSimpleStatement();
       lexer.Expect<TokenType::Newline>();
@@ -408,13 +707,22 @@ private:
 
   //StatementBody -> return Expression
   //               | print ExpressionList
+  //               | del Expression '[' Expression ']'
+  //               | break
+  //               | continue
   //               | AssignmentOrCall
   unique_ptr<Ast::Statement> ParseSimpleStatement() {
     const auto& tok = lexer.CurrentToken();
 
     if (tok.Is<TokenType::Return>()) {
       lexer.NextToken();
-      return make_unique<Ast::Return>(ParseTest());
+      auto value = ParseTest();
+      if (in_method && dynamic_cast<Ast::MethodCall*>(value.get())) {
+        return Ast::Return::TailCall(
+          unique_ptr<Ast::MethodCall>(static_cast<Ast::MethodCall*>(value.release()))
+        );
+      }
+      return make_unique<Ast::Return>(std::move(value));
     } else if (tok.Is<TokenType::Print>()) {
       lexer.NextToken();
       vector<unique_ptr<Ast::Statement>> args;
@@ -422,12 +730,39 @@ private:
         args = ParseTestList();
       }
       return make_unique<Ast::Print>(std::move(args));
+    } else if (tok.Is<TokenType::Del>()) {
+      lexer.NextToken();
+      auto target = ParseMult();
+      auto index = dynamic_cast<Ast::Index*>(target.get());
+      if (!index) {
+        throw ParseError("del supports only subscripted targets");
+      }
+      return make_unique<Ast::Delete>(std::move(index->object), std::move(index->index));
+    } else if (tok.Is<TokenType::Break>() || tok.Is<TokenType::Continue>()) {
+      if (loop_depth == 0) {
+        throw ParseError(tok.Is<TokenType::Break>() ? "'break' outside loop" : "'continue' outside loop");
+      }
+      const bool is_break = tok.Is<TokenType::Break>();
+      lexer.NextToken();
+      if (is_break) {
+        return make_unique<Ast::Break>();
+      }
+      return make_unique<Ast::Continue>();
     } else {
       return ParseAssignmentOrCall();
     }
   }
 };
 
-unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer) {
-  return Parser{lexer}.ParseProgram();
+const Ast::Statement& LazyMethodBody::Body() const {
+  call_once(parsed, [this] {
+    Parse::Lexer lexer(tokens);
+    body = Parser(lexer, classes).ParseMethodBody();
+    tokens = {};
+  });
+  return *body;
+}
+
+unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer, ParseOptions options) {
+  return Parser{lexer, options}.ParseProgram();
 }
@@ -17,6 +17,13 @@ struct ParseError : std::runtime_error {
   using std::runtime_error::runtime_error;
 };
 
-std::unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer);
+struct ParseOptions {
+  // Only check method bodies for indentation and balanced brackets, and parse
+  // each one on its first call. Saves the time and memory of methods a run
+  // never calls; syntax errors in a body surface when it is first called.
+  bool lazy_method_bodies = false;
+};
+
+std::unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer, ParseOptions options = {});
 
 void TestParseProgram(TestRunner& tr);
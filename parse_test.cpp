@@ -1,6 +1,7 @@
 #include "parse.h"
 #include "lexer.h"
 #include "statement.h"
+#include "call_stack.h"
 
 #include "test_runner.h"
 
@@ -11,10 +12,10 @@ using namespace std;
 
 namespace Parse {
 
-unique_ptr<Ast::Statement> ParseProgramFromString(const string& program) {
+unique_ptr<Ast::Statement> ParseProgramFromString(const string& program, ParseOptions options = {}) {
   istringstream is(program);
   Parse::Lexer lexer(is);
-  return ParseProgram(lexer);
+  return ParseProgram(lexer, options);
 }
 
 void TestSimpleProgram() {
@@ -256,6 +257,398 @@ print r, c, t1, t2
 }
 
 
+void TestNestedPrintOrder() {
+  const string program = R"(
+class Noisy:
+  def __str__():
+    print 'inside'
+    return 'noisy'
+
+print 'before', Noisy(), 'after'
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(), "before inside\nnoisy after\n");
+}
+
+void TestComparisonOperators() {
+  const string program = R"(
+class Version:
+  def __init__(major):
+    self.major = major
+
+  def __eq__(other):
+    return self.major == other.major
+
+  def __lt__(other):
+    return self.major < other.major
+
+  def __str__():
+    return 'v' + str(self.major)
+
+class Release(Version):
+  def name():
+    return 'release'
+
+a = Version(1)
+b = Release(2)
+print a == b, a != b, a < b, a > b, a <= b, a >= b
+print b, 1 < 2, 'abc' < 'abd', False < True, 2 <= 2, 3 >= 4
+print 1 == '1', 1 != '1', 1 < '1', 1 > '1', None == None
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(),
+    "False True True False True False\n"
+    "v2 True True True True False\n"
+    "False True False True False\n"
+  );
+}
+
+void TestLists() {
+  const string program = R"(
+class Holder:
+  def __init__():
+    self.items = [1, 'two']
+
+x = [10, 20, 30]
+x.append(40)
+x[0] = x[-1] + 1
+print x, len(x), x[1:3], x[:-2], x[2:], x[3:1]
+last = x.pop()
+first = x.pop(0)
+print last, first, x, len([]), len('abc')
+grid = [[1, 2], [3, 4]]
+grid[1][0] = 5
+print grid[1], grid[0] == [1, 2], [1, 2] < [1, 3], [1] + [None, True]
+h = Holder()
+h.items[1] = 'three'
+print h.items
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(),
+    "[41, 20, 30, 40] 4 [20, 30] [41, 20] [30, 40] []\n"
+    "40 41 [20, 30] 0 3\n"
+    "[5, 4] True True [1, None, True]\n"
+    "[1, 'three']\n"
+  );
+}
+
+void TestDicts() {
+  const string program = R"(
+ages = {'alice': 31, 'bob': 27}
+ages['carol'] = 40
+ages['alice'] = ages['alice'] + 1
+del ages['bob']
+print ages, len(ages), 'bob' in ages, 'carol' in ages, {}
+print ages.get('bob'), ages.get('bob', 0), ages.keys(), ages.values()
+print ages.pop('carol'), ages, 2 in [1, 2], 'ell' in 'hello'
+numbers = {1: 'one', 2.0: 'two'}
+print numbers[1.0], numbers[2]
+x = [1, 2, 3]
+del x[1]
+print x
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(),
+    "{'alice': 32, 'carol': 40} 2 False True {}\n"
+    "None 0 ['alice', 'carol'] [32, 40]\n"
+    "40 {'alice': 32} True True\n"
+    "one two\n"
+    "[1, 3]\n"
+  );
+}
+
+void TestSelfContainingContainers() {
+  const string program = R"(
+x = [1]
+x.append(x)
+d = {'k': 1}
+d['self'] = d
+d['list'] = x
+print x, d, x == x, [x] == [x], x != x
+y = [1]
+y.append(y)
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(), "[1, [...]] {'k': 1, 'self': {...}, 'list': [1, [...]]} True True False\n");
+
+  // Two distinct cycles never reach a decision
+  auto compare = ParseProgramFromString("print x == y\n");
+  ASSERT_THROWS(
+    Runtime::RunOnInterpreterStack([&] { compare->Execute(closure); }),
+    Runtime::RecursionError
+  );
+
+  // Reference counting alone does not free cycles
+  auto unlink = ParseProgramFromString("x.pop()\ny.pop()\ndel d['self']\n");
+  unlink->Execute(closure);
+}
+
+void TestLoops() {
+  const string program = R"(
+class Finder:
+  def first_even(items):
+    for item in items:
+      if item == 0:
+        continue
+      for skip in range(3):
+        break
+      if item / 2 * 2 == item:
+        return item
+    return None
+
+total = 0
+for i in range(10):
+  if i == 7:
+    break
+  if i / 2 * 2 == i:
+    continue
+  total = total + i
+print total, i
+
+n = 5
+while n > 0:
+  n = n - 2
+print n, range(5), range(1, 10, 3), range(5, 0, -2)
+
+for key in {'a': 1, 'b': 2}:
+  print key
+for c in 'hi':
+  print c
+finder = Finder()
+print finder.first_even([0, 3, 5, 8, 10])
+for j in range(3):
+  counters = [j]
+print counters
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(),
+    "9 7\n"
+    "-1 [0, 1, 2, 3, 4] [1, 4, 7] [5, 3, 1]\n"
+    "a\nb\nh\ni\n"
+    "8\n"
+    "[2]\n"
+  );
+
+  ASSERT_THROWS(ParseProgramFromString("break\n"), ParseError);
+  ASSERT_THROWS(ParseProgramFromString(R"(
+while True:
+  class Inner:
+    def f():
+      continue
+)"), ParseError);
+}
+
+void TestReturnNoneFromLoops() {
+  const string program = R"(
+class Exits:
+  def from_while():
+    n = 0
+    while True:
+      n = n + 1
+      if n == 3:
+        self.last = n
+        return None
+    self.last = 'missed'
+
+  def from_range():
+    for i in range(10):
+      if i == 4:
+        self.last = i
+        return None
+    self.last = 'missed'
+
+  def from_list(items):
+    for item in items:
+      if item == 'b':
+        self.last = item
+        return None
+    self.last = 'missed'
+
+  def from_if(x):
+    if x:
+      return None
+    return 'fell through'
+
+e = Exits()
+print e.from_while(), e.last
+print e.from_range(), e.last
+print e.from_list(['a', 'b', 'c']), e.last
+print e.from_if(True), e.from_if(False)
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(),
+    "None 3\n"
+    "None 4\n"
+    "None b\n"
+    "None fell through\n"
+  );
+}
+
+void TestTailCalls() {
+  const string program = R"(
+class Counter:
+  def __init__():
+    self.items = [1, 2, 3]
+
+  def count_down(n, acc):
+    if n == 0:
+      return acc
+    return self.count_down(n - 1, acc + 1)
+
+  def ping(n):
+    if n == 0:
+      return 'done'
+    return self.peer.pong(n - 1)
+
+  def pong(n):
+    return self.peer.ping(n)
+
+  def last():
+    return self.items.pop()
+
+a = Counter()
+b = Counter()
+a.peer = b
+b.peer = a
+print a.count_down(1000000, 0), a.ping(100001), a.last(), a.items
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(), "1000000 done 3 [1, 2]\n");
+}
+
+void TestBuiltins() {
+  const string program = R"(
+values = [3, -7, 2]
+print len(values), abs(-7), abs(-2.5), min(values), max(values), max(1, 9, 4)
+print int('42') + 1, int(3.9), int(True), float(2), str(min('b', 'a')) + '!'
+print hash('key') == hash('key'), hash(2) == hash(2.0)
+)";
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program);
+  tree->Execute(closure);
+
+  ASSERT_EQUAL(os.str(),
+    "3 7 2.5 -7 3 9\n"
+    "43 3 1 2.0 a!\n"
+    "True True\n"
+  );
+
+  ASSERT_THROWS(ParseProgramFromString("x = abs(1, 2)\n"), ParseError);
+  ASSERT_THROWS(ParseProgramFromString("x = min()\n"), ParseError);
+  ASSERT_THROWS(ParseProgramFromString("x = unknown(1)\n"), ParseError);
+}
+
+
+void TestLazyMethodBodies() {
+  const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+
+class Walker(Point):
+  def walk(n, x):
+    if n == 0:
+      return Point(x, self.y)
+    return self.walk(n - 1, x + 1)
+
+  def nest():
+    class Inner:
+      def get():
+        return [1, {'a': (2)}]
+    return Inner()
+
+  def unused():
+    x = = 1
+
+w = Walker(0, 5)
+inner = w.nest()
+print str(w.walk(1000, 0)), inner.get()
+)";
+
+  ParseOptions lazy;
+  lazy.lazy_method_bodies = true;
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+
+  Runtime::Closure closure;
+  auto tree = ParseProgramFromString(program, lazy);
+  tree->Execute(closure);
+  ASSERT_EQUAL(os.str(), "(1000, 5) [1, {'a': 2}]\n");
+
+  ASSERT_THROWS(ParseProgramFromString(program), runtime_error);
+  auto w = closure.at("w").TryAs<Runtime::ClassInstance>();
+  ASSERT(w);
+  ASSERT_THROWS(w->Call("unused", {}), runtime_error);
+  ASSERT_THROWS(w->Call("unused", {}), runtime_error);
+
+  ASSERT_THROWS(ParseProgramFromString("class A:\n  def f():\n    return (1]\n", lazy), ParseError);
+  ASSERT_THROWS(ParseProgramFromString("class A:\n  def f():\n    return [1\n", lazy), ParseError);
+}
 
 }
 
@@ -268,4 +661,14 @@ void TestParseProgram(TestRunner& tr) {
   RUN_TEST(tr, Parse::TestRecursion2);
   RUN_TEST(tr, Parse::TestComplexLogicalExpression);
   RUN_TEST(tr, Parse::TestClassicalPolymorphism);
+  RUN_TEST(tr, Parse::TestNestedPrintOrder);
+  RUN_TEST(tr, Parse::TestComparisonOperators);
+  RUN_TEST(tr, Parse::TestLists);
+  RUN_TEST(tr, Parse::TestDicts);
+  RUN_TEST(tr, Parse::TestSelfContainingContainers);
+  RUN_TEST(tr, Parse::TestLoops);
+  RUN_TEST(tr, Parse::TestReturnNoneFromLoops);
+  RUN_TEST(tr, Parse::TestTailCalls);
+  RUN_TEST(tr, Parse::TestBuiltins);
+  RUN_TEST(tr, Parse::TestLazyMethodBodies);
 }
@@ -0,0 +1,24 @@
+#include "program.h"
+#include "lexer.h"
+#include "statement.h"
+
+namespace Runtime {
+
+std::shared_ptr<const Program> Program::Compile(std::istream& source, ParseOptions options) {
+  Parse::Lexer lexer(source);
+  return Compile(lexer, options);
+}
+
+std::shared_ptr<const Program> Program::Compile(Parse::Lexer& lexer, ParseOptions options) {
+  return std::make_shared<const Program>(ParseProgram(lexer, options));
+}
+
+Program::Program(std::unique_ptr<Ast::Statement> root) : root(std::move(root)) {}
+
+Program::~Program() = default;
+
+void Program::Execute(Closure& globals) const {
+  root->Execute(globals);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "object.h"
+#include "parse.h"
+
+#include <istream>
+#include <memory>
+
+namespace Ast {
+struct Statement;
+}
+
+namespace Runtime {
+
+// A parsed program. It is immutable, so any number of executions, on any
+// threads, may run one image at the same time, each with its own globals;
+// classes and constants of the program are shared by all of them read-only.
+class Program {
+public:
+  static std::shared_ptr<const Program> Compile(std::istream& source, ParseOptions options = {});
+  static std::shared_ptr<const Program> Compile(Parse::Lexer& lexer, ParseOptions options = {});
+
+  explicit Program(std::unique_ptr<Ast::Statement> root);
+  ~Program();
+
+  void Execute(Closure& globals) const;
+
+private:
+  std::unique_ptr<const Ast::Statement> root;
+};
+
+} /* namespace Runtime */
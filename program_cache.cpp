@@ -0,0 +1,316 @@
+#include "program_cache.h"
+#include "lexer.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Runtime {
+
+namespace {
+
+using Parse::Token;
+using Parse::TokenBase;
+namespace TokenType = Parse::TokenType;
+
+constexpr char MAGIC[8] = {'M', 'Y', 'T', 'H', 'O', 'N', 'T', 'K'};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t token_kinds;  // guards against a changed token set
+  uint64_t source_hash;
+  uint64_t source_size;
+  uint64_t string_count;
+  uint64_t string_bytes;
+  uint64_t token_count;
+};
+
+// Followed by the source_size bytes of the source, string_count + 1 offsets
+// into the string bytes, the bytes themselves and then the tokens, each
+// section padded to 8 bytes
+struct TokenRecord {
+  uint32_t kind;
+  uint32_t text;  // index of the string of Id, String and LongNumber tokens
+  int64_t value;  // Number and Char values, the bits of a Float
+};
+
+constexpr size_t Padded(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+
+uint64_t HashSource(std::string_view source) {
+  // FNV-1a: stable across builds and platforms, unlike std::hash
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : source) {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  return hash;
+}
+
+Header MakeHeader(std::string_view source) {
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = ProgramCache::FORMAT_VERSION;
+  header.token_kinds = std::variant_size_v<TokenBase>;
+  header.source_hash = HashSource(source);
+  header.source_size = source.size();
+  return header;
+}
+
+// Tokens whose payload goes to the string table
+template <typename T>
+constexpr bool HAS_TEXT = std::is_same_v<T, TokenType::Id> || std::is_same_v<T, TokenType::String>
+  || std::is_same_v<T, TokenType::LongNumber>;
+
+template <size_t Kind>
+Token DecodeToken(const TokenRecord& record, const std::vector<std::string>& strings) {
+  using T = std::variant_alternative_t<Kind, TokenBase>;
+  if constexpr (std::is_same_v<T, TokenType::Number>) {
+    return T{record.value};
+  } else if constexpr (std::is_same_v<T, TokenType::Char>) {
+    return T{static_cast<char>(record.value)};
+  } else if constexpr (std::is_same_v<T, TokenType::Float>) {
+    double value;
+    std::memcpy(&value, &record.value, sizeof(value));
+    return T{value};
+  } else if constexpr (HAS_TEXT<T>) {
+    return T{strings[record.text]};
+  } else {
+    return T{};
+  }
+}
+
+template <size_t... Kinds>
+constexpr auto MakeDecoders(std::index_sequence<Kinds...>) {
+  return std::array{&DecodeToken<Kinds>...};
+}
+
+template <size_t... Kinds>
+constexpr auto MakeTextKinds(std::index_sequence<Kinds...>) {
+  return std::array{HAS_TEXT<std::variant_alternative_t<Kinds, TokenBase>>...};
+}
+
+constexpr auto KINDS = std::make_index_sequence<std::variant_size_v<TokenBase>>();
+constexpr auto DECODERS = MakeDecoders(KINDS);
+constexpr auto TEXT_KINDS = MakeTextKinds(KINDS);
+
+// Tokens with a string payload: its index among the distinct strings
+class StringTable {
+public:
+  uint32_t Add(const std::string& text) {
+    auto [it, inserted] = indices.emplace(text, static_cast<uint32_t>(strings.size()));
+    if (inserted) {
+      strings.push_back(&it->first);
+    }
+    return it->second;
+  }
+
+  const std::vector<const std::string*>& Strings() const { return strings; }
+
+private:
+  std::unordered_map<std::string, uint32_t> indices;
+  std::vector<const std::string*> strings;
+};
+
+TokenRecord EncodeToken(const Token& token, StringTable& strings) {
+  TokenRecord record{static_cast<uint32_t>(token.index()), 0, 0};
+  std::visit([&record, &strings](const auto& value) {
+    using T = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<T, TokenType::Number>) {
+      record.value = value.value;
+    } else if constexpr (std::is_same_v<T, TokenType::Char>) {
+      record.value = value.value;
+    } else if constexpr (std::is_same_v<T, TokenType::Float>) {
+      std::memcpy(&record.value, &value.value, sizeof(value.value));
+    } else if constexpr (HAS_TEXT<T>) {
+      record.text = strings.Add(value.value);
+    }
+  }, static_cast<const TokenBase&>(token));
+  return record;
+}
+
+std::vector<Token> Lex(std::string_view source) {
+  std::istringstream input{std::string(source)};
+  Parse::Lexer lexer(input);
+  std::vector<Token> tokens{lexer.CurrentToken()};
+  while (!tokens.back().Is<TokenType::Eof>()) {
+    tokens.push_back(lexer.NextToken());
+  }
+  return tokens;
+}
+
+// Closes the descriptor and unmaps the file on every path out of Load
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address != MAP_FAILED) {
+        data = static_cast<const char*>(address);
+        size = info.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data) {
+      munmap(const_cast<char*>(data), size);
+    }
+  }
+
+  const char* data = nullptr;
+  size_t size = 0;
+};
+
+// Tokens of a valid entry for source; nullopt for anything else
+std::optional<std::vector<Token>> Load(const std::string& path, std::string_view source) {
+  MappedFile file(path);
+  if (file.size < sizeof(Header)) {
+    return std::nullopt;
+  }
+  Header header;
+  std::memcpy(&header, file.data, sizeof(header));
+  const Header expected = MakeHeader(source);
+  if (std::memcmp(header.magic, expected.magic, sizeof(MAGIC)) != 0 || header.version != expected.version
+      || header.token_kinds != expected.token_kinds || header.source_hash != expected.source_hash
+      || header.source_size != expected.source_size) {
+    return std::nullopt;
+  }
+
+  const size_t source_at = sizeof(Header);
+  if (header.string_count >= file.size || header.string_bytes >= file.size || header.token_count >= file.size
+      || source_at + Padded(source.size()) > file.size) {
+    return std::nullopt;
+  }
+  // The hash only names the entry: it is the source that has to match
+  if (std::memcmp(file.data + source_at, source.data(), source.size()) != 0) {
+    return std::nullopt;
+  }
+  const size_t offsets_at = source_at + Padded(source.size());
+  const size_t bytes_at = offsets_at + Padded((header.string_count + 1) * sizeof(uint64_t));
+  const size_t tokens_at = bytes_at + Padded(header.string_bytes);
+  if (tokens_at + header.token_count * sizeof(TokenRecord) != file.size) {
+    return std::nullopt;
+  }
+
+  std::vector<std::string> strings;
+  strings.reserve(header.string_count);
+  const auto* offsets = reinterpret_cast<const uint64_t*>(file.data + offsets_at);
+  for (size_t i = 0; i < header.string_count; ++i) {
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.string_bytes) {
+      return std::nullopt;
+    }
+    strings.emplace_back(file.data + bytes_at + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+
+  std::vector<Token> tokens;
+  tokens.reserve(header.token_count);
+  const auto* records = reinterpret_cast<const TokenRecord*>(file.data + tokens_at);
+  for (size_t i = 0; i < header.token_count; ++i) {
+    const TokenRecord& record = records[i];
+    if (record.kind >= DECODERS.size() || (TEXT_KINDS[record.kind] && record.text >= strings.size())) {
+      return std::nullopt;
+    }
+    tokens.push_back(DECODERS[record.kind](record, strings));
+  }
+  return tokens;
+}
+
+void Store(const std::string& path, std::string_view source, const std::vector<Token>& tokens) {
+  StringTable strings;
+  std::vector<TokenRecord> records;
+  records.reserve(tokens.size());
+  for (const Token& token : tokens) {
+    records.push_back(EncodeToken(token, strings));
+  }
+
+  std::vector<uint64_t> offsets{0};
+  std::string bytes;
+  for (const std::string* text : strings.Strings()) {
+    bytes += *text;
+    offsets.push_back(bytes.size());
+  }
+
+  Header header = MakeHeader(source);
+  header.string_count = strings.Strings().size();
+  header.string_bytes = bytes.size();
+  header.token_count = records.size();
+
+  std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+  image += source;
+  image.resize(Padded(image.size()));
+  image.append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+  image.resize(Padded(image.size()));
+  image += bytes;
+  image.resize(Padded(image.size()));
+  image.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TokenRecord));
+
+  // A failed write only costs the next process a lex
+  std::string temporary = path + ".XXXXXX";
+  const int fd = mkstemp(temporary.data());
+  if (fd < 0) {
+    return;
+  }
+  // mkstemp creates the file private; entries are meant to be shared
+  fchmod(fd, 0644);
+  size_t written = 0;
+  while (written < image.size()) {
+    const ssize_t result = write(fd, image.data() + written, image.size() - written);
+    if (result <= 0) {
+      break;
+    }
+    written += result;
+  }
+  close(fd);
+  if (written != image.size() || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+  }
+}
+
+}
+
+ProgramCache::ProgramCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string ProgramCache::EntryPath(std::string_view source) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.mytk", static_cast<unsigned long long>(HashSource(source)));
+  return directory + "/" + name;
+}
+
+std::shared_ptr<const Program> ProgramCache::Compile(std::string_view source, ParseOptions options) const {
+  const std::string path = EntryPath(source);
+  if (auto tokens = Load(path, source)) {
+    Parse::Lexer lexer(std::move(*tokens));
+    return Program::Compile(lexer, options);
+  }
+  std::vector<Token> tokens = Lex(source);
+  Parse::Lexer lexer(tokens);
+  auto program = Program::Compile(lexer, options);
+  // Only programs that parse are worth keeping
+  Store(path, source, tokens);
+  return program;
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "program.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Lexed programs kept in a directory across processes. Lexing is most of the
+// cost of compiling, so an entry holds the token stream of one source text:
+// a header, the source itself, a table of distinct strings (identifiers and
+// literals) and an array of fixed-size token records. It is read back with a
+// single mmap.
+//
+// Entries are named after a hash of the source. On load the stored source is
+// compared with the one being compiled byte for byte, so sources whose
+// hashes collide never share an entry; a missing, stale or damaged entry is
+// replaced. Entries are written to a temporary file and
+// renamed into place, so concurrent processes may share one directory.
+class ProgramCache {
+public:
+  // Bump whenever the lexer changes what it produces for the same text
+  static constexpr uint32_t FORMAT_VERSION = 2;
+
+  explicit ProgramCache(std::string directory);
+
+  std::shared_ptr<const Program> Compile(std::string_view source, ParseOptions options = {}) const;
+
+  const std::string& Directory() const { return directory; }
+  // File that holds, or would hold, the entry for source
+  std::string EntryPath(std::string_view source) const;
+
+private:
+  std::string directory;
+};
+
+void RunProgramCacheTests(TestRunner& tr);
+
+} /* namespace Runtime */
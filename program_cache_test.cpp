@@ -0,0 +1,161 @@
+#include "program_cache.h"
+#include "interpreter.h"
+#include "lexer.h"
+
+#include "test_runner.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+struct CacheDir {
+  string path;
+
+  CacheDir() {
+    char name[] = "/tmp/mython_cache_XXXXXX";
+    if (!mkdtemp(name)) {
+      throw runtime_error("mkdtemp() failed");
+    }
+    path = name;
+  }
+
+  ~CacheDir() {
+    system(("rm -rf " + path).c_str());
+  }
+};
+
+const string SOURCE = R"(
+class Greeter:
+  def __init__(name):
+    self.name = name
+
+  def greet(times):
+    for i in range(times):
+      print 'hello,', self.name, i * 1.5
+    return 100000000000000000000 * times
+
+g = Greeter("cache")
+print g.greet(2) != None, -7 <= 3, {'k': [1, 2]}['k'][1]
+)";
+
+const string OUTPUT = "hello, cache 0.0\nhello, cache 1.5\nTrue True 2\n";
+
+string Run(shared_ptr<const Program> program) {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+  interpreter.Run(std::move(program));
+  return os.str();
+}
+
+ino_t Inode(const string& path) {
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 ? info.st_ino : 0;
+}
+}
+
+void TestLexerReplaysTokens() {
+  istringstream first(SOURCE);
+  Parse::Lexer original(first);
+  vector<Parse::Token> tokens{original.CurrentToken()};
+  while (!tokens.back().Is<Parse::TokenType::Eof>()) {
+    tokens.push_back(original.NextToken());
+  }
+
+  Parse::Lexer replay(tokens);
+  for (const Parse::Token& token : tokens) {
+    ASSERT_EQUAL(replay.CurrentToken(), token);
+    replay.NextToken();
+  }
+  ASSERT(replay.CurrentToken().Is<Parse::TokenType::Eof>());
+}
+
+void TestCacheStoresAndReusesEntries() {
+  CacheDir dir;
+  ProgramCache cache(dir.path);
+  const string entry = cache.EntryPath(SOURCE);
+  ASSERT_EQUAL(Inode(entry), 0u);
+
+  ASSERT_EQUAL(Run(cache.Compile(SOURCE)), OUTPUT);
+  const ino_t stored = Inode(entry);
+  ASSERT(stored != 0);
+
+  // A hit reads the entry and leaves it in place
+  ASSERT_EQUAL(Run(cache.Compile(SOURCE)), OUTPUT);
+  ASSERT_EQUAL(Inode(entry), stored);
+
+  ASSERT(cache.EntryPath(SOURCE + "\n") != entry);
+}
+
+void TestDamagedEntriesAreReplaced() {
+  CacheDir dir;
+  ProgramCache cache(dir.path);
+  const string entry = cache.EntryPath(SOURCE);
+  cache.Compile(SOURCE);
+
+  struct stat info;
+  stat(entry.c_str(), &info);
+  const off_t size = info.st_size;
+  ASSERT_EQUAL(truncate(entry.c_str(), size - 3), 0);
+  ASSERT_EQUAL(Run(cache.Compile(SOURCE)), OUTPUT);
+  stat(entry.c_str(), &info);
+  ASSERT_EQUAL(info.st_size, size);
+
+  ofstream(entry) << "garbage";
+  ASSERT_EQUAL(Run(cache.Compile(SOURCE)), OUTPUT);
+  stat(entry.c_str(), &info);
+  ASSERT_EQUAL(info.st_size, size);
+}
+
+void TestCollidingEntriesAreNotUsed() {
+  CacheDir dir;
+  ProgramCache cache(dir.path);
+  const string first = "print 'one'\n";
+  const string second = "print 'two'\n";
+  ASSERT_EQUAL(Run(cache.Compile(first)), "one\n");
+  ASSERT_EQUAL(Run(cache.Compile(second)), "two\n");
+
+  // Forge a collision: the entry of first, under the name and with the hash
+  // of second, which has the same size. The hash is the third field of the
+  // header, after the magic and two 32-bit fields.
+  auto read = [](const string& path) {
+    ifstream file(path, ios::binary);
+    return string(istreambuf_iterator<char>(file), {});
+  };
+  const string second_entry = cache.EntryPath(second);
+  string forged = read(cache.EntryPath(first));
+  forged.replace(16, 8, read(second_entry).substr(16, 8));
+  ofstream(second_entry, ios::binary | ios::trunc) << forged;
+
+  ASSERT_EQUAL(Run(cache.Compile(second)), "two\n");
+  ASSERT(read(second_entry) != forged);
+}
+
+void TestFailedProgramsAreNotCached() {
+  CacheDir dir;
+  ProgramCache cache(dir.path);
+  const string bad = "class Broken:\n  def f(:\n    return 1\n";
+  ASSERT_THROWS(cache.Compile(bad), std::exception);
+  ASSERT_EQUAL(Inode(cache.EntryPath(bad)), 0u);
+}
+
+void RunProgramCacheTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestLexerReplaysTokens);
+  RUN_TEST(tr, Runtime::TestCacheStoresAndReusesEntries);
+  RUN_TEST(tr, Runtime::TestDamagedEntriesAreReplaced);
+  RUN_TEST(tr, Runtime::TestCollidingEntriesAreNotUsed);
+  RUN_TEST(tr, Runtime::TestFailedProgramsAreNotCached);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,88 @@
+#include "record_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace Runtime {
+
+double StreamReport::RecordsPerSecond() const {
+  const double seconds = chrono::duration<double>(total).count();
+  return seconds > 0 ? records / seconds : 0.0;
+}
+
+optional<string> ReadRecord(istream& input, RecordFormat format) {
+  string record;
+  if (format == RecordFormat::Lines) {
+    if (!getline(input, record)) {
+      return nullopt;
+    }
+    if (!record.empty() && record.back() == '\r') {
+      record.pop_back();
+    }
+    return record;
+  }
+
+  unsigned char prefix[4];
+  if (!input.read(reinterpret_cast<char*>(prefix), 1)) {
+    return nullopt;
+  }
+  if (!input.read(reinterpret_cast<char*>(prefix) + 1, 3)) {
+    throw runtime_error("truncated record length");
+  }
+  const uint32_t size = uint32_t{prefix[0]} << 24 | uint32_t{prefix[1]} << 16 | uint32_t{prefix[2]} << 8 | prefix[3];
+  record.resize(size);
+  if (!input.read(record.data(), size)) {
+    throw runtime_error("truncated record");
+  }
+  return record;
+}
+
+StreamReport RunStream(Module& module, const StreamOptions& options, istream& input, OutputSink& output) {
+  const auto start = chrono::steady_clock::now();
+  const Class& cls = module.GetClass(options.class_name);
+  const MethodHandle handle = module.Prepare(cls, options.method);
+  const ObjectHolder instance = module.New(cls);
+  Interpreter& interpreter = module.GetInterpreter();
+
+  StreamReport report;
+  string line;
+  try {
+    while (auto record = ReadRecord(input, options.format)) {
+      ObjectHolder result = handle(instance, {ToObject(std::move(*record))});
+      ++report.records;
+      if (result) {
+        line.clear();
+        // __str__ of the result, or of anything inside it, is script code
+        // and runs with the interpreter bound
+        interpreter.Enter([&] {
+          result->PrintTo(line);
+          return ObjectHolder::None();
+        });
+        line += '\n';
+        output.Write(line);
+      }
+      if (report.records % max<size_t>(options.batch_size, 1) == 0) {
+        output.Flush();
+      }
+    }
+  } catch (const exception& e) {
+    output.Flush();
+    throw runtime_error("record " + to_string(report.records + 1) + ": " + e.what());
+  }
+  output.Flush();
+  report.total = chrono::steady_clock::now() - start;
+  return report;
+}
+
+void PrintStreamReport(const StreamReport& report, ostream& os) {
+  os << "records: " << report.records
+     << ", total: " << chrono::duration<double, milli>(report.total).count() << " ms"
+     << ", throughput: " << report.RecordsPerSecond() << " records/s\n";
+}
+
+} /* namespace Runtime */
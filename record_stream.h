@@ -0,0 +1,52 @@
+#pragma once
+
+#include "module.h"
+#include "output_sink.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+
+class TestRunner;
+
+namespace Runtime {
+
+enum class RecordFormat {
+  Lines,           // one record per line, without the line break
+  LengthPrefixed,  // a 32-bit big-endian byte count, then that many bytes
+};
+
+struct StreamOptions {
+  std::string class_name;
+  std::string method;
+  RecordFormat format = RecordFormat::Lines;
+  // Results buffered before the output is flushed
+  size_t batch_size = 4096;
+};
+
+struct StreamReport {
+  size_t records = 0;
+  std::chrono::nanoseconds total{0};
+
+  double RecordsPerSecond() const;
+};
+
+// Reads one record; nullopt at the end of the input. Throws on a truncated
+// length-prefixed record.
+std::optional<std::string> ReadRecord(std::istream& input, RecordFormat format);
+
+// Creates one instance of options.class_name (its __init__ takes no
+// arguments) and calls options.method with every record of input as a
+// string, printing each result that is not None on a line of its own. The
+// program is never parsed again and the method is resolved once. A failing
+// call stops the stream with an error naming the record; the output of the
+// records before it is flushed.
+StreamReport RunStream(Module& module, const StreamOptions& options, std::istream& input, OutputSink& output);
+
+void PrintStreamReport(const StreamReport& report, std::ostream& os);
+
+void RunRecordStreamTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,128 @@
+#include "record_stream.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+const string PROCESSOR = R"(
+class Tag:
+  def __init__(text):
+    self.text = text
+
+  def __str__():
+    return '<' + self.text + '>'
+
+class Loud:
+  def __str__():
+    print 'formatting'
+    return 'loud'
+
+class Processor:
+  def __init__():
+    self.seen = 0
+
+  def handle(record):
+    self.seen = self.seen + 1
+    if record == 'tag':
+      return Tag(str(self.seen))
+    if record == 'loud':
+      return [Loud(), Tag('x')]
+    if record == 'fail':
+      return 1 / 0
+    if record != 'skip':
+      return str(self.seen) + ':' + record
+)";
+
+// Counts how often the output was flushed
+class CountingSink : public StreamSink {
+public:
+  using StreamSink::StreamSink;
+  void Flush() override {
+    ++flushes;
+    StreamSink::Flush();
+  }
+  size_t flushes = 0;
+};
+
+string LengthPrefixed(const string& record) {
+  string result(4, '\0');
+  result[2] = static_cast<char>(record.size() >> 8);
+  result[3] = static_cast<char>(record.size() & 0xff);
+  return result + record;
+}
+
+}
+
+void TestReadRecord() {
+  istringstream lines("a\r\n\nb");
+  ASSERT_EQUAL(*ReadRecord(lines, RecordFormat::Lines), "a");
+  ASSERT_EQUAL(*ReadRecord(lines, RecordFormat::Lines), "");
+  ASSERT_EQUAL(*ReadRecord(lines, RecordFormat::Lines), "b");
+  ASSERT(!ReadRecord(lines, RecordFormat::Lines));
+
+  const string long_record(300, 'x');
+  istringstream prefixed(LengthPrefixed("one\ntwo") + LengthPrefixed("") + LengthPrefixed(long_record));
+  ASSERT_EQUAL(*ReadRecord(prefixed, RecordFormat::LengthPrefixed), "one\ntwo");
+  ASSERT_EQUAL(*ReadRecord(prefixed, RecordFormat::LengthPrefixed), "");
+  ASSERT_EQUAL(*ReadRecord(prefixed, RecordFormat::LengthPrefixed), long_record);
+  ASSERT(!ReadRecord(prefixed, RecordFormat::LengthPrefixed));
+
+  istringstream truncated(LengthPrefixed("abc").substr(0, 5));
+  ASSERT_THROWS(ReadRecord(truncated, RecordFormat::LengthPrefixed), runtime_error);
+}
+
+void TestRunStream() {
+  istringstream source(PROCESSOR);
+  ostringstream os;
+  CountingSink output(os);
+  Module module(source, output);
+
+  StreamOptions options{"Processor", "handle"};
+  options.batch_size = 2;
+  istringstream input("x\nskip\ntag\ny\nz\n");
+  const size_t flushes = output.flushes;
+  const StreamReport report = RunStream(module, options, input, output);
+
+  ASSERT_EQUAL(os.str(), "1:x\n<3>\n4:y\n5:z\n");
+  ASSERT_EQUAL(report.records, 5u);
+  // After records 2 and 4, and at the end
+  ASSERT_EQUAL(output.flushes - flushes, 3u);
+
+  ostringstream summary;
+  PrintStreamReport(report, summary);
+  ASSERT(summary.str().find("records: 5") != string::npos);
+
+  os.str("");
+  istringstream failing("a\nfail\nb\n");
+  try {
+    RunStream(module, options, failing, output);
+    ASSERT(false);
+  } catch (const runtime_error& e) {
+    ASSERT(string(e.what()).find("record 2") == 0);
+  }
+  ASSERT_EQUAL(os.str(), "1:a\n");
+
+  // Elements of a container are formatted by the module's interpreter too,
+  // so what their __str__ prints goes to the module's output
+  os.str("");
+  istringstream loud("loud\n");
+  RunStream(module, options, loud, output);
+  ASSERT_EQUAL(os.str(), "formatting\n[loud, <x>]\n");
+
+  ASSERT_THROWS(RunStream(module, {"Missing", "handle"}, input, output), runtime_error);
+  ASSERT_THROWS(RunStream(module, {"Processor", "missing"}, input, output), runtime_error);
+}
+
+void RunRecordStreamTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestReadRecord);
+  RUN_TEST(tr, Runtime::TestRunStream);
+}
+
+} /* namespace Runtime */
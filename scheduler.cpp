@@ -0,0 +1,35 @@
+#include "scheduler.h"
+
+namespace Runtime {
+
+Scheduler::Scheduler(size_t time_slice) : time_slice(time_slice) {}
+
+size_t Scheduler::Add(Interpreter& interpreter, std::shared_ptr<const Program> program) {
+  entries.push_back({std::make_unique<Task>(interpreter, std::move(program)), nullptr, 0});
+  ready.push_back(entries.size() - 1);
+  return entries.size() - 1;
+}
+
+size_t Scheduler::Run() {
+  size_t failed = 0;
+  while (!ready.empty()) {
+    const size_t index = ready.front();
+    ready.pop_front();
+    Entry& entry = entries[index];
+    ++entry.slices;
+    try {
+      if (!entry.task->Resume(time_slice)) {
+        ready.push_back(index);
+        continue;
+      }
+    } catch (...) {
+      entry.error = std::current_exception();
+      ++failed;
+    }
+    // Finished: release the native stack right away
+    entry.task.reset();
+  }
+  return failed;
+}
+
+} /* namespace Runtime */
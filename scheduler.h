@@ -0,0 +1,49 @@
+#pragma once
+
+#include "interpreter.h"
+#include "program.h"
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Multiplexes many script runs on the calling thread. Tasks take turns, one
+// time slice of steps each, so a long or runaway script delays the others by
+// at most a slice per round.
+class Scheduler {
+public:
+  static constexpr size_t DEFAULT_TIME_SLICE = 10'000;
+
+  explicit Scheduler(size_t time_slice = DEFAULT_TIME_SLICE);
+
+  // The interpreter must outlive the scheduler. Returns the task's index.
+  size_t Add(Interpreter& interpreter, std::shared_ptr<const Program> program);
+
+  // Runs until every task has finished and returns how many of them failed
+  size_t Run();
+
+  std::exception_ptr Error(size_t task) const { return entries[task].error; }
+  // Number of slices the task has been given
+  size_t Slices(size_t task) const { return entries[task].slices; }
+
+private:
+  struct Entry {
+    std::unique_ptr<Task> task;
+    std::exception_ptr error;
+    size_t slices = 0;
+  };
+
+  size_t time_slice;
+  std::vector<Entry> entries;
+  std::deque<size_t> ready;
+};
+
+void RunSchedulerTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,183 @@
+#include "scheduler.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+shared_ptr<const Program> CompileSource(const string& source) {
+  istringstream input(source);
+  return Program::Compile(input);
+}
+
+const string COUNT_TO_50 = R"(
+i = 0
+while i < 50:
+  print name, i
+  i = i + 1
+)";
+
+string Counted(const string& name, int count) {
+  string result;
+  for (int i = 0; i < count; ++i) {
+    result += name + " " + to_string(i) + "\n";
+  }
+  return result;
+}
+}
+
+void TestTaskResumesWhereItStopped() {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+  interpreter.Globals()["name"] = ObjectHolder::Own(String("n"));
+
+  Task task(interpreter, CompileSource(COUNT_TO_50));
+  ASSERT(!task.Resume(10));
+  const size_t first_slice = os.str().size();
+  ASSERT(first_slice > 0 && first_slice < Counted("n", 50).size());
+  ASSERT(Interpreter::Current() == nullptr);
+  ASSERT_EQUAL(CallStack::Current().Depth(), 0u);
+
+  int slices = 1;
+  while (!task.Resume(10)) {
+    ++slices;
+  }
+  ASSERT(task.Done());
+  ASSERT(slices > 5);
+  ASSERT_EQUAL(os.str(), Counted("n", 50));
+}
+
+void TestTaskCancelsRunawayScript() {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+  {
+    Task task(interpreter, CompileSource(R"(
+class Spinner:
+  def spin(depth):
+    if depth > 0:
+      return self.spin(depth - 1)
+    n = 0
+    while True:
+      n = n + 1
+
+s = Spinner()
+print 'start'
+s.spin(100)
+)"));
+    for (int i = 0; i < 100; ++i) {
+      ASSERT(!task.Resume(1000));
+    }
+    ASSERT_EQUAL(CallStack::Current().Depth(), 0u);
+  }
+  ASSERT_EQUAL(os.str(), "start\n");
+
+  // The interpreter is free again once the task is gone
+  istringstream next("print 'next'\n");
+  interpreter.Run(next);
+  ASSERT_EQUAL(os.str(), "start\nnext\n");
+}
+
+void TestSchedulerInterleavesTasks() {
+  ostringstream os;
+  StreamSink first_sink(os);
+  StreamSink second_sink(os);
+  Interpreter first(first_sink);
+  Interpreter second(second_sink);
+  first.Globals()["name"] = ObjectHolder::Own(String("a"));
+  second.Globals()["name"] = ObjectHolder::Own(String("b"));
+
+  auto program = CompileSource(COUNT_TO_50);
+  Scheduler scheduler(10);
+  const size_t a = scheduler.Add(first, program);
+  const size_t b = scheduler.Add(second, program);
+  ASSERT_EQUAL(scheduler.Run(), 0u);
+
+  const string output = os.str();
+  ASSERT(output.find("b 0\n") < output.find("a 49\n"));
+  ASSERT(scheduler.Slices(a) > 5);
+  ASSERT(scheduler.Slices(b) > 5);
+  ASSERT_EQUAL(output.size(), 2 * Counted("a", 50).size());
+}
+
+void TestSchedulerReportsErrors() {
+  ostringstream good_output;
+  StreamSink good_sink(good_output);
+  Interpreter good(good_sink);
+  good.Globals()["name"] = ObjectHolder::Own(String("g"));
+
+  ostringstream deep_output;
+  StreamSink deep_sink(deep_output);
+  Interpreter deep(deep_sink, Limits{50});
+
+  Scheduler scheduler(5);
+  const size_t g = scheduler.Add(good, CompileSource(COUNT_TO_50));
+  const size_t d = scheduler.Add(deep, CompileSource(R"(
+class Deep:
+  def down(n):
+    return 1 + self.down(n + 1)
+
+x = Deep()
+print x.down(0)
+)"));
+  ASSERT_EQUAL(scheduler.Run(), 1u);
+
+  ASSERT(!scheduler.Error(g));
+  ASSERT(scheduler.Error(d));
+  ASSERT_THROWS(rethrow_exception(scheduler.Error(d)), RecursionError);
+  ASSERT_EQUAL(good_output.str(), Counted("g", 50));
+  ASSERT_EQUAL(deep_output.str(), "");
+}
+
+void TestSuspendedPrintKeepsItsLine() {
+  const string program = R"(
+class Slow:
+  def word():
+    a = 1
+    b = 2
+    c = 3
+    return 'word'
+
+s = Slow()
+i = 0
+while i < 10:
+  print name, s.word()
+  i = i + 1
+)";
+  ostringstream first_output, second_output;
+  StreamSink first_sink(first_output), second_sink(second_output);
+  Interpreter first(first_sink), second(second_sink);
+  first.Globals()["name"] = ObjectHolder::Own(String("x"));
+  second.Globals()["name"] = ObjectHolder::Own(String("y"));
+
+  Scheduler scheduler(2);
+  auto image = CompileSource(program);
+  scheduler.Add(first, image);
+  scheduler.Add(second, image);
+  ASSERT_EQUAL(scheduler.Run(), 0u);
+
+  string expected_first, expected_second;
+  for (int i = 0; i < 10; ++i) {
+    expected_first += "x word\n";
+    expected_second += "y word\n";
+  }
+  ASSERT_EQUAL(first_output.str(), expected_first);
+  ASSERT_EQUAL(second_output.str(), expected_second);
+}
+
+void RunSchedulerTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestTaskResumesWhereItStopped);
+  RUN_TEST(tr, Runtime::TestTaskCancelsRunawayScript);
+  RUN_TEST(tr, Runtime::TestSchedulerInterleavesTasks);
+  RUN_TEST(tr, Runtime::TestSchedulerReportsErrors);
+  RUN_TEST(tr, Runtime::TestSuspendedPrintKeepsItsLine);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,467 @@
+#include "server.h"
+#include "call_stack.h"
+#include "memory.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+// Every response frame is a kind byte, a 32-bit payload size in host order
+// and the payload. A response is any number of Output frames followed by
+// either Done or Error.
+enum class FrameKind : char {
+  Output = 'o',
+  Done = 'd',
+  Error = 'e',
+};
+
+constexpr size_t FRAME_CAPACITY = 1 << 16;
+
+// Steps a script runs between checks of its run time
+constexpr size_t TIME_SLICE = 10'000;
+
+// A request the server will not run; the client is told why
+class RequestRejected : public runtime_error {
+public:
+  using runtime_error::runtime_error;
+};
+
+struct FileDescriptor {
+  int fd;
+
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+  ~FileDescriptor() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+sockaddr_un SocketAddress(const string& path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw runtime_error("socket path is too long: " + path);
+  }
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+
+// MSG_NOSIGNAL: a client that went away must not take the server down
+void SendAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("connection lost");
+    }
+    data += sent;
+    size -= static_cast<size_t>(sent);
+  }
+}
+
+void SendFrame(int fd, FrameKind kind, string_view payload) {
+  char header[1 + sizeof(uint32_t)];
+  header[0] = static_cast<char>(kind);
+  const uint32_t size = static_cast<uint32_t>(payload.size());
+  memcpy(header + 1, &size, sizeof(size));
+  SendAll(fd, header, sizeof(header));
+  SendAll(fd, payload.data(), payload.size());
+}
+
+// Returns false on a clean end of stream before the first byte
+bool ReceiveAll(int fd, char* data, size_t size) {
+  for (size_t received = 0; received < size;) {
+    const ssize_t count = recv(fd, data + received, size - received, 0);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0 || (count == 0 && received > 0)) {
+      throw runtime_error("connection lost");
+    }
+    if (count == 0) {
+      return false;
+    }
+    received += static_cast<size_t>(count);
+  }
+  return true;
+}
+
+// Reads until the client shuts down its side of the connection. The whole
+// request must arrive before the deadline, however slowly it trickles in.
+string ReceiveRequest(int fd, size_t max_size, chrono::milliseconds timeout) {
+  const auto deadline = chrono::steady_clock::now() + timeout;
+  string data;
+  char chunk[FRAME_CAPACITY];
+  for (;;) {
+    const auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+    pollfd readable{fd, POLLIN, 0};
+    const int ready = left.count() > 0 ? poll(&readable, 1, static_cast<int>(left.count())) : 0;
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready == 0) {
+      throw RequestRejected("request not received within " + to_string(timeout.count()) + " ms");
+    }
+    const ssize_t count = ready < 0 ? -1 : recv(fd, chunk, sizeof(chunk), 0);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("connection lost");
+    }
+    if (count == 0) {
+      return data;
+    }
+    if (data.size() + static_cast<size_t>(count) > max_size) {
+      throw RequestRejected("request is larger than " + to_string(max_size) + " bytes");
+    }
+    data.append(chunk, static_cast<size_t>(count));
+  }
+}
+
+// Sends the output of a script as Output frames of up to FRAME_CAPACITY bytes
+class FrameSink : public OutputSink {
+public:
+  explicit FrameSink(int fd) : fd(fd) {
+    buffer.reserve(FRAME_CAPACITY);
+  }
+
+  void Write(string_view data) override {
+    while (buffer.size() + data.size() > FRAME_CAPACITY) {
+      const size_t part = FRAME_CAPACITY - buffer.size();
+      buffer.append(data.substr(0, part));
+      data.remove_prefix(part);
+      Flush();
+    }
+    buffer.append(data);
+  }
+
+  void Flush() override {
+    if (!buffer.empty()) {
+      SendFrame(fd, FrameKind::Output, buffer);
+      buffer.clear();
+    }
+  }
+
+private:
+  int fd;
+  string buffer;
+};
+
+}
+
+Server::Server(
+  string socket_path, size_t thread_count, Limits limits, ParseOptions parse_options, RequestLimits request_limits
+)
+  : socket_path(std::move(socket_path)), thread_count(thread_count), limits(limits)
+  , parse_options(parse_options), request_limits(request_limits)
+{
+  const sockaddr_un address = SocketAddress(this->socket_path);
+  if (pipe2(stop_pipe, O_CLOEXEC) != 0) {
+    throw runtime_error("pipe() failed");
+  }
+  // Non-blocking, so that a process that loses a race for a connection goes
+  // back to poll() instead of waiting in accept4() where a stop is not seen
+  listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (listener < 0) {
+    throw runtime_error("socket() failed");
+  }
+  // A socket file left behind by a server that did not exit cleanly
+  unlink(this->socket_path.c_str());
+  if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+      || listen(listener, SOMAXCONN) != 0) {
+    close(listener);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    throw runtime_error("cannot listen on " + this->socket_path + ": " + strerror(errno));
+  }
+}
+
+Server::~Server() {
+  pool.reset();
+  close(listener);
+  close(stop_pipe[0]);
+  close(stop_pipe[1]);
+  unlink(socket_path.c_str());
+}
+
+int Server::Accept() {
+  pollfd watched[2] = {{listener, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+  for (;;) {
+    if (poll(watched, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("poll() failed");
+    }
+    // The stop byte is never read, so every process polling the pipe sees it
+    if (watched[1].revents) {
+      return -1;
+    }
+    // Forked workers all wait on one listener; the losers of a race find
+    // nothing to accept. A client may also have given up in the backlog.
+    const int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (connection >= 0) {
+      return connection;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED) {
+      throw runtime_error("accept() failed: "s + strerror(errno));
+    }
+  }
+}
+
+void Server::Serve() {
+  pool = make_unique<ThreadPool>(thread_count);
+  for (int connection; (connection = Accept()) >= 0;) {
+    pool->Submit([this, connection] { Handle(connection); });
+  }
+  pool->Wait();
+}
+
+void Server::RunWorker() {
+  // The parent decides when workers stop; a terminal's Ctrl-C reaches the
+  // whole process group
+  signal(SIGINT, SIG_IGN);
+  signal(SIGTERM, SIG_DFL);
+  try {
+    for (int connection; (connection = Accept()) >= 0;) {
+      Handle(connection);
+    }
+  } catch (...) {
+    _exit(1);
+  }
+  // Skips the destructors: the socket file belongs to the parent
+  _exit(0);
+}
+
+void Server::ServeForked(size_t worker_count) {
+  unordered_set<pid_t> workers;
+  auto spawn = [this, &workers] {
+    const pid_t pid = fork();
+    if (pid < 0) {
+      throw runtime_error("fork() failed");
+    }
+    if (pid == 0) {
+      RunWorker();
+    }
+    workers.insert(pid);
+  };
+  for (size_t i = 0; i < max<size_t>(worker_count, 1); ++i) {
+    spawn();
+  }
+
+  pollfd stop{stop_pipe[0], POLLIN, 0};
+  for (;;) {
+    // Woken up regularly to replace workers that died
+    const int ready = poll(&stop, 1, 100);
+    if (ready > 0) {
+      break;
+    }
+    for (pid_t pid; (pid = waitpid(-1, nullptr, WNOHANG)) > 0;) {
+      if (workers.erase(pid)) {
+        spawn();
+      }
+    }
+  }
+  for (pid_t pid : workers) {
+    waitpid(pid, nullptr, 0);
+  }
+}
+
+void Server::Preload(const string& path) {
+  shared_ptr<const Program> program = Load(path);
+  lock_guard lock(programs_mutex);
+  // An alias without a control block: copies of it do not write to the
+  // program's reference count
+  programs[path].program = shared_ptr<const Program>(shared_ptr<const Program>(), program.get());
+  preloaded.push_back(std::move(program));
+}
+
+void Server::Stop() {
+  const char byte = 0;
+  // Only async-signal-safe calls here; a full pipe means a stop is pending
+  [[maybe_unused]] const ssize_t written = write(stop_pipe[1], &byte, 1);
+}
+
+shared_ptr<const Program> Server::Load(const string& path) {
+  struct stat status;
+  if (stat(path.c_str(), &status) != 0) {
+    throw runtime_error("cannot open script " + path);
+  }
+  {
+    lock_guard lock(programs_mutex);
+    if (auto it = programs.find(path); it != programs.end()) {
+      const WarmProgram& warm = it->second;
+      if (warm.mtime.tv_sec == status.st_mtim.tv_sec && warm.mtime.tv_nsec == status.st_mtim.tv_nsec
+          && warm.size == status.st_size) {
+        return warm.program;
+      }
+    }
+  }
+
+  // Parsed without the lock: concurrent first runs of one script may both
+  // parse it, but runs of other scripts are never held up
+  ifstream source(path);
+  if (!source) {
+    throw runtime_error("cannot open script " + path);
+  }
+  auto program = Program::Compile(source, parse_options);
+  ++compilations;
+
+  lock_guard lock(programs_mutex);
+  programs[path] = {status.st_mtim, status.st_size, program};
+  return program;
+}
+
+void Server::Execute(Interpreter& interpreter, shared_ptr<const Program> program) const {
+  const auto started = chrono::steady_clock::now();
+  const size_t max_steps = request_limits.max_steps;
+  const auto max_run_time = request_limits.max_run_time;
+  Task task(interpreter, std::move(program));
+  for (size_t steps = 0;;) {
+    const size_t slice = max_steps > 0 ? min(TIME_SLICE, max_steps - steps) : TIME_SLICE;
+    if (task.Resume(slice)) {
+      return;
+    }
+    steps += slice;
+    if (max_steps > 0 && steps >= max_steps) {
+      throw RequestRejected("script exceeded its budget of " + to_string(max_steps) + " steps");
+    }
+    if (max_run_time.count() > 0 && chrono::steady_clock::now() - started >= max_run_time) {
+      throw RequestRejected("script ran for longer than " + to_string(max_run_time.count()) + " ms");
+    }
+  }
+}
+
+void Server::Handle(int connection) {
+  FileDescriptor client{connection};
+  try {
+    const timeval send_timeout{
+      static_cast<time_t>(request_limits.io_timeout.count() / 1000),
+      static_cast<suseconds_t>(request_limits.io_timeout.count() % 1000 * 1000)
+    };
+    setsockopt(client.fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    string request;
+    try {
+      request = ReceiveRequest(client.fd, request_limits.max_request_size, request_limits.io_timeout);
+    } catch (const RequestRejected& e) {
+      SendFrame(client.fd, FrameKind::Error, e.what());
+      return;
+    }
+    const size_t end_of_path = request.find('\n');
+    if (end_of_path == string::npos) {
+      SendFrame(client.fd, FrameKind::Error, "malformed request");
+      return;
+    }
+    istringstream input(request.substr(end_of_path + 1));
+
+    FrameSink output(client.fd);
+    string error;
+    try {
+      auto program = Load(request.substr(0, end_of_path));
+      Interpreter interpreter(output, limits);
+      interpreter.SetInput(input);
+      Execute(interpreter, std::move(program));
+    } catch (const RecursionError& e) {
+      error = "RecursionError: "s + e.what();
+    } catch (const MemoryError& e) {
+      error = "MemoryError: "s + e.what();
+    } catch (const exception& e) {
+      error = e.what();
+    }
+    output.Flush();
+    if (error.empty()) {
+      SendFrame(client.fd, FrameKind::Done, "");
+    } else {
+      SendFrame(client.fd, FrameKind::Error, error);
+    }
+  } catch (const exception&) {
+    // The client is gone; there is nobody to report to
+  }
+}
+
+int RunClient(const string& socket_path, const string& script, istream& input, OutputSink& output, ostream& errors) {
+  char* absolute = realpath(script.c_str(), nullptr);
+  if (!absolute) {
+    errors << "cannot open script " << script << endl;
+    return 1;
+  }
+  string request = absolute;
+  free(absolute);
+  request += '\n';
+  request.append(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+
+  try {
+    const sockaddr_un address = SocketAddress(socket_path);
+    FileDescriptor server{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if (server.fd < 0 || connect(server.fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+      errors << "cannot connect to " << socket_path << ": " << strerror(errno) << endl;
+      return 1;
+    }
+    SendAll(server.fd, request.data(), request.size());
+    shutdown(server.fd, SHUT_WR);
+
+    string payload;
+    for (;;) {
+      char header[1 + sizeof(uint32_t)];
+      if (!ReceiveAll(server.fd, header, sizeof(header))) {
+        throw runtime_error("connection lost");
+      }
+      uint32_t size;
+      memcpy(&size, header + 1, sizeof(size));
+      payload.resize(size);
+      if (size > 0 && !ReceiveAll(server.fd, payload.data(), size)) {
+        throw runtime_error("connection lost");
+      }
+
+      switch (static_cast<FrameKind>(header[0])) {
+      case FrameKind::Output:
+        output.Write(payload);
+        break;
+      case FrameKind::Done:
+        output.Flush();
+        return 0;
+      case FrameKind::Error:
+        output.Flush();
+        errors << payload << endl;
+        return 1;
+      default:
+        throw runtime_error("malformed response");
+      }
+    }
+  } catch (const exception& e) {
+    output.Flush();
+    errors << e.what() << endl;
+    return 1;
+  }
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "interpreter.h"
+#include "output_sink.h"
+#include "parse.h"
+#include "program.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Bounds on every request to a Server, so that neither a slow client nor a
+// runaway script can keep a thread or a worker to itself. A request that
+// breaks one is answered with an error.
+struct RequestLimits {
+  // Time a client has to send its whole request. Sending output to a client
+  // that does not read it gives up after the same time.
+  std::chrono::milliseconds io_timeout{10'000};
+  // Bytes of the path line and the input together
+  size_t max_request_size = 64 << 20;
+  // Steps (statements and method calls) and wall-clock time a script may
+  // run for; zero means no limit
+  size_t max_steps = 0;
+  std::chrono::milliseconds max_run_time{60'000};
+};
+
+// A resident interpreter on a Unix domain socket. A client connects, sends the
+// absolute path of a script on one line followed by the script's input, and
+// shuts down its side of the connection. The server runs the script in a fresh
+// Interpreter and streams back framed output, then one frame with the outcome.
+// Connections are served concurrently on a thread pool, or by forked worker
+// processes (see ServeForked). Parsed scripts stay in memory and are reused
+// until the file's mtime or size changes. Every request is held to the
+// server's RequestLimits.
+class Server {
+public:
+  Server(
+    std::string socket_path, size_t thread_count, Limits limits = {},
+    ParseOptions parse_options = {}, RequestLimits request_limits = {}
+  );
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+  // Removes the socket file
+  ~Server();
+
+  // Parses a script ahead of its first request. Preloaded programs are held
+  // without reference counting on the request path, so processes forked
+  // afterwards share their pages instead of copying them.
+  void Preload(const std::string& path);
+
+  // Accepts connections until Stop(), then waits for the ones in progress
+  void Serve();
+  // Forks worker_count processes that accept connections and run them one at
+  // a time, so that a script can only bring down its own worker. The calling
+  // process replaces workers that die and, on Stop(), lets the rest finish
+  // their current request. Must be called before Serve() and with no other
+  // threads of the server running.
+  void ServeForked(size_t worker_count);
+  // May be called from any thread and from a signal handler
+  void Stop();
+
+  // Times a script has been parsed, for all scripts together
+  size_t Compilations() const { return compilations; }
+
+private:
+  struct WarmProgram {
+    timespec mtime;
+    off_t size;
+    std::shared_ptr<const Program> program;
+  };
+
+  std::shared_ptr<const Program> Load(const std::string& path);
+  void Handle(int connection);
+  // Runs the script as a Task, a time slice at a time, within request_limits
+  void Execute(Interpreter& interpreter, std::shared_ptr<const Program> program) const;
+  // Waits for a connection; returns -1 once stopped
+  int Accept();
+  void RunWorker();
+
+  std::string socket_path;
+  size_t thread_count;
+  Limits limits;
+  ParseOptions parse_options;
+  RequestLimits request_limits;
+  int listener = -1;
+  int stop_pipe[2] = {-1, -1};
+
+  std::mutex programs_mutex;
+  std::unordered_map<std::string, WarmProgram> programs;
+  // Owners of the preloaded programs, which programs refers to by aliases
+  std::vector<std::shared_ptr<const Program>> preloaded;
+  std::atomic<size_t> compilations = 0;
+
+  // Started by Serve(), as threads do not survive a fork
+  std::unique_ptr<ThreadPool> pool;
+};
+
+// Runs script on the server listening on socket_path as if it were run
+// directly: all of input is sent as its input, the output goes to output and
+// an error message to errors. Returns the exit status for the mython command.
+int RunClient(
+  const std::string& socket_path, const std::string& script,
+  std::istream& input, OutputSink& output, std::ostream& errors
+);
+
+void RunServerTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,207 @@
+#include "server.h"
+
+#include "test_runner.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+struct TempDir {
+  string path;
+
+  TempDir() {
+    char name[] = "/tmp/mython_server_XXXXXX";
+    if (!mkdtemp(name)) {
+      throw runtime_error("mkdtemp() failed");
+    }
+    path = name;
+  }
+
+  ~TempDir() {
+    system(("rm -rf " + path).c_str());
+  }
+
+  string File(const string& name, const string& content) const {
+    const string file = path + "/" + name;
+    ofstream(file) << content;
+    return file;
+  }
+};
+
+struct ClientRun {
+  int status;
+  string output;
+  string errors;
+};
+
+ClientRun Run(const string& socket, const string& script, const string& input) {
+  istringstream in(input);
+  ostringstream out, errors;
+  StreamSink sink(out);
+  const int status = RunClient(socket, script, in, sink, errors);
+  return {status, out.str(), errors.str()};
+}
+
+// Serves on a thread of its own for as long as it exists
+struct ServingThread {
+  Server& server;
+  thread serving;
+
+  explicit ServingThread(Server& server) : server(server), serving([&server] { server.Serve(); }) {}
+  ~ServingThread() {
+    server.Stop();
+    serving.join();
+  }
+};
+
+}
+
+void TestServerRunsScripts() {
+  TempDir dir;
+  const string socket = dir.path + "/mython.sock";
+  const string echo = dir.File("echo.my", R"(
+line = input()
+while line:
+  print line
+  line = input()
+)");
+  const string broken = dir.File("broken.my", "print 'before'\nprint 1 / 0\n");
+
+  {
+    Server server(socket, 4);
+    ServingThread serving(server);
+
+    vector<ClientRun> runs(16);
+    vector<thread> clients;
+    for (size_t i = 0; i < runs.size(); ++i) {
+      clients.emplace_back([&, i] {
+        runs[i] = Run(socket, echo, "a\nb" + to_string(i) + "\n");
+      });
+    }
+    for (thread& client : clients) {
+      client.join();
+    }
+    for (size_t i = 0; i < runs.size(); ++i) {
+      ASSERT_EQUAL(runs[i].status, 0);
+      ASSERT_EQUAL(runs[i].output, "a\nb" + to_string(i) + "\n");
+      ASSERT_EQUAL(runs[i].errors, "");
+    }
+    const size_t compilations = server.Compilations();
+    ASSERT(compilations >= 1 && compilations <= runs.size());
+    Run(socket, echo, "");
+    ASSERT_EQUAL(server.Compilations(), compilations);
+
+    const ClientRun failed = Run(socket, broken, "");
+    ASSERT_EQUAL(failed.status, 1);
+    ASSERT_EQUAL(failed.output, "before\n");
+    ASSERT(!failed.errors.empty());
+
+    // A changed script is parsed again
+    dir.File("echo.my", "print 'changed'\n");
+    ASSERT_EQUAL(Run(socket, echo, "").output, "changed\n");
+    ASSERT_EQUAL(server.Compilations(), compilations + 2);
+
+    ASSERT_EQUAL(Run(socket, dir.path + "/missing.my", "").status, 1);
+  }
+  // Nothing listens once the server is gone
+  ASSERT_EQUAL(Run(socket, echo, "").status, 1);
+}
+
+void TestForkedServer() {
+  TempDir dir;
+  const string socket = dir.path + "/mython.sock";
+  const string echo = dir.File("echo.my", "print input()\n");
+  const string other = dir.File("other.my", "print 'other'\n");
+
+  Server server(socket, 1);
+  server.Preload(echo);
+  ASSERT_EQUAL(server.Compilations(), 1u);
+  thread serving([&server] { server.ServeForked(3); });
+
+  vector<ClientRun> runs(12);
+  vector<thread> clients;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    clients.emplace_back([&, i] {
+      runs[i] = Run(socket, i % 2 ? echo : other, to_string(i) + "\n");
+    });
+  }
+  for (thread& client : clients) {
+    client.join();
+  }
+  server.Stop();
+  serving.join();
+
+  for (size_t i = 0; i < runs.size(); ++i) {
+    ASSERT_EQUAL(runs[i].status, 0);
+    ASSERT_EQUAL(runs[i].output, i % 2 ? to_string(i) + "\n" : "other\n");
+  }
+  // Workers parse what was not preloaded in their own memory
+  ASSERT_EQUAL(server.Compilations(), 1u);
+}
+
+void TestServerRequestLimits() {
+  TempDir dir;
+  const string socket = dir.path + "/mython.sock";
+  const string echo = dir.File("echo.my", "print input()\n");
+  const string endless = dir.File("endless.my", "n = 0\nwhile True:\n  n = n + 1\n");
+
+  RequestLimits request_limits;
+  request_limits.io_timeout = chrono::milliseconds(200);
+  request_limits.max_request_size = 1000;
+  request_limits.max_steps = 100'000;
+  {
+    Server server(socket, 1, {}, {}, request_limits);
+    ServingThread serving(server);
+
+    // A client that connects and sends nothing holds the only thread until
+    // the receive deadline, and no longer
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    socket.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int idle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT(connect(idle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    const ClientRun served = Run(socket, echo, "after idle\n");
+    ASSERT_EQUAL(served.status, 0);
+    ASSERT_EQUAL(served.output, "after idle\n");
+    close(idle);
+
+    const ClientRun large = Run(socket, echo, string(2000, 'x'));
+    ASSERT_EQUAL(large.status, 1);
+    ASSERT(large.errors.find("larger than 1000 bytes") != string::npos);
+
+    const ClientRun stepped = Run(socket, endless, "");
+    ASSERT_EQUAL(stepped.status, 1);
+    ASSERT(stepped.errors.find("100000 steps") != string::npos);
+  }
+
+  request_limits.max_steps = 0;
+  request_limits.max_run_time = chrono::milliseconds(100);
+  Server server(socket, 1, {}, {}, request_limits);
+  ServingThread serving(server);
+  const ClientRun timed = Run(socket, endless, "");
+  ASSERT_EQUAL(timed.status, 1);
+  ASSERT(timed.errors.find("longer than 100 ms") != string::npos);
+  ASSERT_EQUAL(Run(socket, echo, "still serving\n").output, "still serving\n");
+}
+
+void RunServerTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestServerRunsScripts);
+  RUN_TEST(tr, Runtime::TestForkedServer);
+  RUN_TEST(tr, Runtime::TestServerRequestLimits);
+}
+
+} /* namespace Runtime */
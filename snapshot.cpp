@@ -0,0 +1,185 @@
+#include "snapshot.h"
+#include "object.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Runtime {
+
+namespace {
+
+bool IsMutable(const ObjectHolder& object) {
+  switch (KindOf(object)) {
+    case ObjectKind::List:
+    case ObjectKind::Dict:
+    case ObjectKind::Instance:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Copies the mutable part of an object graph. Owning handles in the graph
+// become owning handles to the copies. Non-owning handles (such as a stored
+// `self`) follow the object they refer to if it is copied too, and keep
+// referring to the original if it lives outside the graph. Both passes use a
+// work list, so long chains of objects cannot exhaust the native stack.
+class GraphCopier {
+public:
+  explicit GraphCopier(const Closure& roots) {
+    std::vector<const ObjectHolder*> pending;
+    for (const auto& [name, object] : roots) {
+      pending.push_back(&object);
+    }
+    while (!pending.empty()) {
+      const ObjectHolder& object = *pending.back();
+      pending.pop_back();
+      if (!IsMutable(object)) {
+        continue;
+      }
+      if (object.IsOwning()) {
+        owned.insert(object.Get());
+      }
+      if (visited.insert(object.Get()).second) {
+        ForEachReference(*object, [&pending](const ObjectHolder& child) { pending.push_back(&child); });
+      }
+    }
+  }
+
+  ObjectHolder Copy(const ObjectHolder& object) {
+    if (!IsMutable(object)) {
+      return object;
+    }
+    const Object* original = object.Get();
+    const bool owning = object.IsOwning();
+    if (!owning && !owned.count(original)) {
+      return object;
+    }
+    auto [it, inserted] = copies.emplace(original, ObjectHolder());
+    // References into the map stay valid while it grows
+    ObjectHolder& copy = it->second;
+    if (inserted) {
+      copy = MakeShell(object);
+      unfilled.push_back(&copy);
+    }
+    return owning ? copy : ObjectHolder::Share(*copy);
+  }
+
+  // Replaces the references inside every copy made so far (and the copies
+  // this makes in turn) with references to copies
+  void Fill() {
+    while (!unfilled.empty()) {
+      Object& copy = **unfilled.back();
+      unfilled.pop_back();
+      switch (copy.Kind()) {
+        case ObjectKind::List:
+          for (ObjectHolder& item : static_cast<List&>(copy).Items()) {
+            item = Copy(item);
+          }
+          break;
+        case ObjectKind::Dict:
+          static_cast<Dict&>(copy).Table().ForEach([this](auto& entry) {
+            entry.value = Copy(entry.value);
+          });
+          break;
+        default:
+          for (auto& [name, field] : static_cast<ClassInstance&>(copy).Fields()) {
+            if (name != "self") {
+              field = Copy(field);
+            }
+          }
+          break;
+      }
+    }
+  }
+
+private:
+  template <typename F>
+  static void ForEachReference(const Object& object, F fn) {
+    switch (object.Kind()) {
+      case ObjectKind::List:
+        for (const ObjectHolder& item : static_cast<const List&>(object).Items()) {
+          fn(item);
+        }
+        break;
+      case ObjectKind::Dict:
+        static_cast<const Dict&>(object).Table().ForEach([&fn](const auto& entry) { fn(entry.value); });
+        break;
+      default:
+        for (const auto& [name, field] : static_cast<const ClassInstance&>(object).Fields()) {
+          if (name != "self") {
+            fn(field);
+          }
+        }
+        break;
+    }
+  }
+
+  // A copy whose references still lead to the originals
+  static ObjectHolder MakeShell(const ObjectHolder& object) {
+    switch (KindOf(object)) {
+      case ObjectKind::List:
+        return ObjectHolder::Own(List(static_cast<const List&>(*object).Items()));
+      case ObjectKind::Dict: {
+        Dict copy;
+        // Keys are immutable and stay shared
+        static_cast<const Dict&>(*object).Table().ForEach([&copy](const auto& entry) {
+          copy.Table().Assign(entry.key, entry.value);
+        });
+        return ObjectHolder::Own(std::move(copy));
+      }
+      default:
+        return ObjectHolder::Own(ClassInstance(static_cast<const ClassInstance&>(*object)));
+    }
+  }
+
+  std::unordered_set<const Object*> visited;
+  std::unordered_set<const Object*> owned;
+  std::unordered_map<const Object*, ObjectHolder> copies;
+  std::vector<ObjectHolder*> unfilled;
+};
+
+// Charges the objects created in its scope to account (none if nullptr)
+class ChargeTo {
+public:
+  explicit ChargeTo(MemoryAccount* account) : outer(MemoryAccount::Bind(account)) {}
+  ChargeTo(const ChargeTo&) = delete;
+  ChargeTo& operator=(const ChargeTo&) = delete;
+  ~ChargeTo() { MemoryAccount::Bind(outer); }
+
+private:
+  MemoryAccount* outer;
+};
+
+Closure CopyGlobals(const Closure& globals) {
+  GraphCopier copier(globals);
+  Closure result;
+  result.reserve(globals.size());
+  for (const auto& [name, object] : globals) {
+    result.emplace(name, copier.Copy(object));
+  }
+  copier.Fill();
+  return result;
+}
+
+}
+
+std::shared_ptr<const Snapshot> Snapshot::Capture(Interpreter& interpreter) {
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->programs = interpreter.programs;
+  // Owned by the snapshot, so not charged to the interpreter
+  ChargeTo no_account(nullptr);
+  snapshot->globals = CopyGlobals(interpreter.globals);
+  return snapshot;
+}
+
+void Snapshot::Restore(Interpreter& interpreter) const {
+  interpreter.programs.insert(interpreter.programs.end(), programs.begin(), programs.end());
+  ChargeTo account(interpreter.memory.get());
+  for (auto& [name, object] : CopyGlobals(globals)) {
+    interpreter.globals[name] = std::move(object);
+  }
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "interpreter.h"
+#include "object_holder.h"
+#include "program.h"
+
+#include <memory>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+
+// The state an interpreter has reached, typically after running a prelude
+// of class definitions and initialization code, captured so that new
+// interpreters can start from it instead of running the prelude again.
+//
+// Programs, classes and immutable values (numbers, strings, ...) are shared
+// by the snapshot and every interpreter restored from it. Lists, dicts and
+// instances are copied, keeping their sharing and cycles, so that no
+// interpreter sees what another one does to them. A snapshot is immutable,
+// so one can be restored on several threads at once.
+class Snapshot {
+public:
+  static std::shared_ptr<const Snapshot> Capture(Interpreter& interpreter);
+
+  // Adds the snapshot's globals to the interpreter's, replacing those with
+  // the same names. The copies are charged to the interpreter's memory.
+  void Restore(Interpreter& interpreter) const;
+
+  const Closure& Globals() const { return globals; }
+
+private:
+  std::vector<std::shared_ptr<const Program>> programs;
+  Closure globals;
+};
+
+void RunSnapshotTests(TestRunner& tr);
+
+} /* namespace Runtime */
@@ -0,0 +1,108 @@
+#include "snapshot.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+const string PRELUDE = R"(
+class Counter:
+  def __init__():
+    self.n = 0
+    self.me = self
+
+  def inc():
+    self.n = self.n + 1
+
+  def get():
+    return self.n
+
+c = Counter()
+items = [1, 2]
+alias = items
+pair = [items, items]
+d = {'a': 1}
+)";
+
+shared_ptr<const Snapshot> CapturePrelude(ostringstream& os) {
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+  istringstream prelude(PRELUDE);
+  interpreter.Run(prelude);
+  return Snapshot::Capture(interpreter);
+}
+
+string RunFrom(const Snapshot& snapshot, const string& source) {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+  snapshot.Restore(interpreter);
+  istringstream program(source);
+  interpreter.Run(program);
+  return os.str();
+}
+}
+
+void TestSnapshotRestoresGlobals() {
+  ostringstream prelude_output;
+  auto snapshot = CapturePrelude(prelude_output);
+
+  const string work = R"(
+c.inc()
+items.append(3)
+d['b'] = 2
+print c.get(), len(items), len(alias), len(pair[1]), len(d)
+)";
+  ASSERT_EQUAL(RunFrom(*snapshot, work), "1 3 3 3 2\n");
+  // Every interpreter starts from the same state
+  ASSERT_EQUAL(RunFrom(*snapshot, work), "1 3 3 3 2\n");
+  ASSERT_EQUAL(RunFrom(*snapshot, "print len(items), len(d), c.get()\n"), "2 1 0\n");
+}
+
+void TestSnapshotFollowsSelfReferences() {
+  ostringstream prelude_output;
+  auto snapshot = CapturePrelude(prelude_output);
+
+  ASSERT_EQUAL(RunFrom(*snapshot, "c.inc()\nprint c.me.get()\n"), "1\n");
+}
+
+void TestSnapshotIsIndependentOfItsSource() {
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter source(sink);
+  istringstream prelude(PRELUDE);
+  source.Run(prelude);
+  auto snapshot = Snapshot::Capture(source);
+
+  istringstream change("items.append(3)\nc.inc()\n");
+  source.Run(change);
+
+  ASSERT_EQUAL(RunFrom(*snapshot, "print len(items), c.get()\n"), "2 0\n");
+}
+
+void TestRestoredObjectsAreCharged() {
+  ostringstream prelude_output;
+  auto snapshot = CapturePrelude(prelude_output);
+
+  ostringstream os;
+  StreamSink sink(os);
+  Interpreter interpreter(sink);
+  ASSERT_EQUAL(interpreter.Memory().Used(), 0u);
+  snapshot->Restore(interpreter);
+  ASSERT(interpreter.Memory().Used() >= sizeof(ClassInstance) + 2 * sizeof(List) + sizeof(Dict));
+}
+
+void RunSnapshotTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestSnapshotRestoresGlobals);
+  RUN_TEST(tr, Runtime::TestSnapshotFollowsSelfReferences);
+  RUN_TEST(tr, Runtime::TestSnapshotIsIndependentOfItsSource);
+  RUN_TEST(tr, Runtime::TestRestoredObjectsAreCharged);
+}
+
+} /* namespace Runtime */
@@ -1,6 +1,10 @@
 #include "statement.h"
 #include "object.h"
+#include "arithmetic.h"
+#include "call_stack.h"
+#include "format.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -10,28 +14,62 @@ namespace Ast {
 
 using Runtime::Closure;
 
-ObjectHolder Assignment::Execute(Closure& closure) {
-  ObjectHolder statement_result = right_value.get()->Execute(closure);
-  closure[var_name] = statement_result;
-  return closure[var_name];
+namespace {
+// Results of comparisons and logical operators: one of two shared, never
+// modified objects instead of a new Bool every time
+ObjectHolder BoolResult(bool value) {
+  static Runtime::Bool true_value(true);
+  static Runtime::Bool false_value(false);
+  return ObjectHolder::Share(value ? true_value : false_value);
 }
 
-Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv) : var_name(var), right_value(std::move(rv)) {
+// Binds a variable to value. A number is copied into the object the variable
+// already holds when no one else refers to that object, so `x = i` in a loop
+// neither allocates nor takes the loop's counter away from StoreCounter.
+void Rebind(ObjectHolder& slot, ObjectHolder value) {
+  const Runtime::ObjectKind kind = KindOf(value);
+  if (slot.IsUnique() && KindOf(slot) == kind) {
+    if (kind == Runtime::ObjectKind::Number) {
+      static_cast<Runtime::Number&>(*slot).value = static_cast<const Runtime::Number&>(*value).GetValue();
+      return;
+    }
+    if (kind == Runtime::ObjectKind::Float) {
+      static_cast<Runtime::Float&>(*slot).value = static_cast<const Runtime::Float&>(*value).GetValue();
+      return;
+    }
+  }
+  slot = std::move(value);
+}
+}
+
+ObjectHolder Assignment::Execute(Closure& closure) const {
+  // References into the closure survive rehashing, and variables are never erased
+  ObjectHolder* defined = closure.Slot(this, var_name);
+  ObjectHolder statement_result = arithmetic && defined
+    ? arithmetic->Execute(closure, defined)
+    : right_value.get()->Execute(closure);
+  ObjectHolder& slot = defined ? *defined : closure[var_name];
+  Rebind(slot, std::move(statement_result));
+  return slot;
+}
+
+Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
+  : var_name(var), right_value(std::move(rv)), arithmetic(dynamic_cast<const ArithmeticOperation*>(right_value.get())) {
 }
 
 VariableValue::VariableValue(std::string var_name) { dotted_ids.push_back(std::move(var_name)); }
 VariableValue::VariableValue(std::vector<std::string> dotted_ids) : dotted_ids(std::move(dotted_ids)) {}
 
-ObjectHolder VariableValue::Execute(Closure& closure) {
-  try {
-    if (dotted_ids.size() == 2) {
-      return closure.at(dotted_ids[0]).TryAs<Runtime::ClassInstance>()->Fields().at(dotted_ids[1]);
+ObjectHolder VariableValue::Execute(Closure& closure) const {
+  ObjectHolder* value = closure.Slot(this, dotted_ids[0]);
+  if (value && dotted_ids.size() == 2) {
+    auto* instance = value->TryAs<Runtime::ClassInstance>();
+    value = instance ? instance->Fields().Slot(&dotted_ids[1], dotted_ids[1]) : nullptr;
   }
-  return closure.at(dotted_ids[0]);
-  
-  } catch (std::out_of_range) {
+  if (!value) {
     throw std::runtime_error("variable is not defined");
   }
+  return *value;
 }
 
 unique_ptr<Print> Print::Variable(std::string var) {
@@ -42,149 +80,347 @@ unique_ptr<Print> Print::Variable(std::string var) {
 Print::Print(unique_ptr<Statement> argument) { args.push_back(std::move(argument)); }
 Print::Print(vector<unique_ptr<Statement>> args) : args(std::move(args)) {}
 
-ObjectHolder Print::Execute(Closure& closure) {
-  if (args.size() == 1) {
-    auto object = args[0].get()->Execute(closure);
-    if (object.Get() == nullptr) { *output << "None";} 
-    else { object.Get()->Print(*output); }
-    
-  } else {
+ObjectHolder Print::Execute(Closure& closure) const {
+  // Prints nested in __str__ or in arguments append to the same pending line,
+  // and the innermost one writes the combined line out when it finishes, so
+  // the output is the same as if every value had been streamed separately.
+  std::string& line = PendingLine();
+  try {
     for (size_t i = 0; i < args.size(); ++i) {
       auto object = args[i].get()->Execute(closure);
-      if (object.Get() == nullptr) { *output << "None"; } 
-      else { object.Get()->Print(*output); }
-      if (i != args.size()-1) { *output << ' '; }
+      if (object.Get() == nullptr) { line.append(Runtime::NONE_LITERAL); }
+      else { object.Get()->PrintTo(line); }
+      if (i != args.size()-1) { line.push_back(' '); }
     }
+  } catch (...) {
+    output->Write(line);
+    line.clear();
+    throw;
   }
-  *output << '\n';
+  line.push_back('\n');
+  output->Write(line);
+  line.clear();
   return ObjectHolder();
 }
 
-ostream* Print::output = &cout;
+namespace {
+Runtime::StreamSink& DefaultStreamSink() {
+  thread_local Runtime::StreamSink sink(cout);
+  return sink;
+}
+}
+
+thread_local Runtime::OutputSink* Print::output = &DefaultStreamSink();
 
 void Print::SetOutputStream(ostream& output_stream) {
-  output = &output_stream;
+  DefaultStreamSink().SetStream(output_stream);
+  output = &DefaultStreamSink();
+}
+
+void Print::SetOutputSink(Runtime::OutputSink& sink) {
+  output = &sink;
+}
+
+Runtime::OutputSink& Print::GetOutputSink() {
+  return *output;
+}
+
+std::string& Print::PendingLine() {
+  thread_local std::string line;
+  return line;
 }
 
 MethodCall::MethodCall(
   std::unique_ptr<Statement> object, std::string method, std::vector<std::unique_ptr<Statement>> args) :
   object(std::move(object)), method(std::move(method)), args(std::move(args)) {}
 
-ObjectHolder MethodCall::Execute(Closure& closure) {
-  auto instance = object.get()->Execute(closure).TryAs<Runtime::ClassInstance>();
+std::vector<ObjectHolder> MethodCall::EvaluateArgs(Closure& closure) const {
   std::vector<ObjectHolder> actual_args;
+  actual_args.reserve(args.size());
   for (const auto& statement : args) {
     actual_args.push_back(statement.get()->Execute(closure));
   }
-  return instance->Call(method, actual_args);
+  return actual_args;
+}
+
+ObjectHolder MethodCall::Execute(Closure& closure) const {
+  ObjectHolder target = object.get()->Execute(closure);
+  return Runtime::CallMethod(target, method, EvaluateArgs(closure));
+}
+
+ObjectHolder MethodCall::ExecuteAsTailCall(Closure& closure) const {
+  ObjectHolder target = object.get()->Execute(closure);
+  std::vector<ObjectHolder> actual_args = EvaluateArgs(closure);
+  return ObjectHolder::Own(Runtime::TailCall(std::move(target), method, std::move(actual_args)));
+}
+
+BuiltinCall::BuiltinCall(const Runtime::Builtin& builtin, std::vector<std::unique_ptr<Statement>> args)
+  : builtin(builtin), args(std::move(args)) {}
+
+ObjectHolder BuiltinCall::Execute(Closure& closure) const {
+  constexpr size_t INLINE_ARGS = 4;
+  if (args.size() <= INLINE_ARGS) {
+    ObjectHolder values[INLINE_ARGS];
+    for (size_t i = 0; i < args.size(); ++i) {
+      values[i] = args[i]->Execute(closure);
+    }
+    return builtin.function(values, args.size());
+  }
+  std::vector<ObjectHolder> values;
+  values.reserve(args.size());
+  for (const auto& arg : args) {
+    values.push_back(arg->Execute(closure));
+  }
+  return builtin.function(values.data(), values.size());
+}
+
+ListLiteral::ListLiteral(std::vector<std::unique_ptr<Statement>> items) : items(std::move(items)) {}
+
+ObjectHolder ListLiteral::Execute(Closure& closure) const {
+  std::vector<ObjectHolder> values;
+  values.reserve(items.size());
+  for (const auto& item : items) {
+    values.push_back(item->Execute(closure));
+  }
+  return ObjectHolder::Own(Runtime::List(std::move(values)));
+}
+
+DictLiteral::DictLiteral(std::vector<std::pair<std::unique_ptr<Statement>, std::unique_ptr<Statement>>> items)
+  : items(std::move(items)) {}
+
+ObjectHolder DictLiteral::Execute(Closure& closure) const {
+  Runtime::Dict dict;
+  for (const auto& [key, value] : items) {
+    ObjectHolder key_value = key->Execute(closure);
+    dict.Table().Assign(key_value, value->Execute(closure));
+  }
+  return ObjectHolder::Own(std::move(dict));
+}
+
+namespace {
+Runtime::List& ExpectList(ObjectHolder& object) {
+  if (Runtime::KindOf(object) != Runtime::ObjectKind::List) {
+    throw std::runtime_error("object is not subscriptable");
+  }
+  return static_cast<Runtime::List&>(*object);
+}
+
+size_t SliceBound(const std::unique_ptr<Statement>& bound, Closure& closure, size_t size, size_t missing) {
+  if (!bound) {
+    return missing;
+  }
+  ObjectHolder value = bound->Execute(closure);
+  if (Runtime::KindOf(value) != Runtime::ObjectKind::Number) {
+    throw std::runtime_error("slice indices must be integers");
+  }
+  int64_t position = value.TryAs<Runtime::Number>()->GetValue();
+  if (position < 0) {
+    position += static_cast<int64_t>(size);
+  }
+  return static_cast<size_t>(std::clamp<int64_t>(position, 0, static_cast<int64_t>(size)));
+}
+}
+
+Index::Index(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index)
+  : object(std::move(object)), index(std::move(index)) {}
+
+ObjectHolder Index::Execute(Closure& closure) const {
+  ObjectHolder target = object->Execute(closure);
+  if (auto dict = target.TryAs<Runtime::Dict>()) {
+    if (const ObjectHolder* value = dict->Table().Find(index->Execute(closure))) {
+      return *value;
+    }
+    throw std::runtime_error("key not found in dict");
+  }
+  Runtime::List& list = ExpectList(target);
+  return list.Items()[list.Position(index->Execute(closure))];
+}
+
+Slice::Slice(std::unique_ptr<Statement> object, std::unique_ptr<Statement> begin, std::unique_ptr<Statement> end)
+  : object(std::move(object)), begin(std::move(begin)), end(std::move(end)) {}
+
+ObjectHolder Slice::Execute(Closure& closure) const {
+  ObjectHolder target = object->Execute(closure);
+  const auto& items = ExpectList(target).Items();
+  size_t first = SliceBound(begin, closure, items.size(), 0);
+  size_t last = SliceBound(end, closure, items.size(), items.size());
+  if (first >= last) {
+    return ObjectHolder::Own(Runtime::List());
+  }
+  return ObjectHolder::Own(Runtime::List({items.begin() + first, items.begin() + last}));
+}
+
+IndexAssignment::IndexAssignment(
+  std::unique_ptr<Statement> object, std::unique_ptr<Statement> index, std::unique_ptr<Statement> rv
+) : object(std::move(object)), index(std::move(index)), right_value(std::move(rv)) {}
+
+ObjectHolder IndexAssignment::Execute(Closure& closure) const {
+  ObjectHolder target = object->Execute(closure);
+  if (auto dict = target.TryAs<Runtime::Dict>()) {
+    ObjectHolder key = index->Execute(closure);
+    ObjectHolder right = right_value->Execute(closure);
+    dict->Table().Assign(key, right);
+    return right;
+  }
+  Runtime::List& list = ExpectList(target);
+  size_t position = list.Position(index->Execute(closure));
+  ObjectHolder right = right_value->Execute(closure);
+  return list.Items()[position] = std::move(right);
+}
+
+Delete::Delete(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index)
+  : object(std::move(object)), index(std::move(index)) {}
+
+ObjectHolder Delete::Execute(Closure& closure) const {
+  ObjectHolder target = object->Execute(closure);
+  if (auto dict = target.TryAs<Runtime::Dict>()) {
+    if (!dict->Table().Erase(index->Execute(closure))) {
+      throw std::runtime_error("key not found in dict");
+    }
+    return ObjectHolder::None();
+  }
+  Runtime::List& list = ExpectList(target);
+  list.Items().erase(list.Items().begin() + list.Position(index->Execute(closure)));
+  return ObjectHolder::None();
+}
+
+ObjectHolder Membership::Execute(Closure& closure) const {
+  ObjectHolder item = lhs->Execute(closure);
+  ObjectHolder container = rhs->Execute(closure);
+  return BoolResult(Runtime::Contains(container, item));
 }
 
-ObjectHolder Stringify::Execute(Closure& closure) {
-  auto object = argument.get()->Execute(closure);
-  std::ostringstream ss;
-  object.Get()->Print(ss);
-  return ObjectHolder::Own(Runtime::String{ss.str()});
+ObjectHolder Stringify::Execute(Closure& closure) const {
+  return Runtime::Stringify(argument.get()->Execute(closure));
 }
 
-ObjectHolder Add::Execute(Closure& closure) {
+ObjectHolder Add::Execute(Closure& closure, const ObjectHolder* destination) const {
   ObjectHolder lhs_res = lhs.get()->Execute(closure);
   ObjectHolder rhs_res = rhs.get()->Execute(closure);
 
+  if (auto result = Runtime::Arithmetic(Runtime::ArithmeticOp::Add, lhs_res, rhs_res, destination)) {
+    return std::move(*result);
+  }
+
   auto lhs_obj = lhs_res.TryAs<Runtime::ClassInstance>();
   if (lhs_obj && lhs_obj->HasMethod("__add__", 1)) {
     ObjectHolder var = rhs.get()->Execute(lhs_obj->Fields());
     return lhs_obj->Call("__add__", {var});
   }
-  
-  Runtime::Number * lhs_num = lhs_res.TryAs<Runtime::Number>();
-  Runtime::Number * rhs_num = rhs_res.TryAs<Runtime::Number>();
-  if (lhs_num && rhs_num) {
-    auto new_value = lhs_num->GetValue() + rhs_num->GetValue();
-    return ObjectHolder::Own(Runtime::Number{new_value});
-  }
 
   Runtime::String * lhs_str = lhs_res.TryAs<Runtime::String>();
   Runtime::String * rhs_str = rhs_res.TryAs<Runtime::String>();
   if (lhs_str && rhs_str) {
-    auto new_value = lhs_str->GetValue() + rhs_str->GetValue();
-    return ObjectHolder::Own(Runtime::String{new_value});
+    return Runtime::MakeString(lhs_str->GetValue() + rhs_str->GetValue());
+  }
+
+  Runtime::List * lhs_list = lhs_res.TryAs<Runtime::List>();
+  Runtime::List * rhs_list = rhs_res.TryAs<Runtime::List>();
+  if (lhs_list && rhs_list) {
+    std::vector<ObjectHolder> items = lhs_list->Items();
+    items.insert(items.end(), rhs_list->Items().begin(), rhs_list->Items().end());
+    return ObjectHolder::Own(Runtime::List(std::move(items)));
   }
 
   throw std::runtime_error("invalid arguments");
 
 }
 
-ObjectHolder Sub::Execute(Closure& closure) {
+ObjectHolder Sub::Execute(Closure& closure, const ObjectHolder* destination) const {
   ObjectHolder lhs_res = lhs.get()->Execute(closure);
   ObjectHolder rhs_res = rhs.get()->Execute(closure);
-  Runtime::Number * lhs_num = lhs_res.TryAs<Runtime::Number>();
-  Runtime::Number * rhs_num = rhs_res.TryAs<Runtime::Number>();
-  if (lhs_num && rhs_num) {
-    auto new_value = lhs_num->GetValue() - rhs_num->GetValue();
-    return ObjectHolder::Own(Runtime::Number{new_value});
+  if (auto result = Runtime::Arithmetic(Runtime::ArithmeticOp::Sub, lhs_res, rhs_res, destination)) {
+    return std::move(*result);
   }
   throw std::runtime_error("invalid arguments");
 }
 
-ObjectHolder Mult::Execute(Runtime::Closure& closure) {
+ObjectHolder Mult::Execute(Closure& closure, const ObjectHolder* destination) const {
   ObjectHolder lhs_res = lhs.get()->Execute(closure);
   ObjectHolder rhs_res = rhs.get()->Execute(closure);
-  Runtime::Number * lhs_num = lhs_res.TryAs<Runtime::Number>();
-  Runtime::Number * rhs_num = rhs_res.TryAs<Runtime::Number>();
-  if (lhs_num && rhs_num) {
-    auto new_value = lhs_num->GetValue() * rhs_num->GetValue();
-    return ObjectHolder::Own(Runtime::Number{new_value});
+  if (auto result = Runtime::Arithmetic(Runtime::ArithmeticOp::Mult, lhs_res, rhs_res, destination)) {
+    return std::move(*result);
   }
   throw std::runtime_error("invalid arguments");
 }
 
-ObjectHolder Div::Execute(Runtime::Closure& closure) {
+ObjectHolder Div::Execute(Closure& closure, const ObjectHolder* destination) const {
   ObjectHolder lhs_res = lhs.get()->Execute(closure);
   ObjectHolder rhs_res = rhs.get()->Execute(closure);
-  Runtime::Number * lhs_num = lhs_res.TryAs<Runtime::Number>();
-  Runtime::Number * rhs_num = rhs_res.TryAs<Runtime::Number>();
-  if (lhs_num && rhs_num) {
-    auto new_value = lhs_num->GetValue() / rhs_num->GetValue();
-    return ObjectHolder::Own(Runtime::Number{new_value});
+  if (auto result = Runtime::Arithmetic(Runtime::ArithmeticOp::Div, lhs_res, rhs_res, destination)) {
+    return std::move(*result);
   }
   throw std::runtime_error("invalid arguments");
 }
 
-ObjectHolder Compound::Execute(Closure& closure) {
-  // ObjectHolder res;
-  // std::string class_name;
-  // for (const auto& statement : statements) {
-  //   res = statement.get()->Execute(closure);
-  //   class_name = typeid(*statement.get()).name();
-  //   if (class_name == "class Ast::IfElse" && res.Get() != nullptr) { return res; }
-  //   if (class_name == "class Ast::Return") { return res; }
-  //   if (class_name == "class Ast::Compound") { return res; }
-  // }
-  // return ObjectHolder::None();
-    for (auto& statement : statements) {
-    auto ret = statement->Execute(closure);
-
-    bool check_for_return = false
-      || dynamic_cast<Return*>(statement.get())
-      || dynamic_cast<IfElse*>(statement.get())
-      || dynamic_cast<Compound*>(statement.get());
-
-    if (check_for_return && ret.Get()) {
+void Compound::AddStatement(std::unique_ptr<Statement> stmt) {
+  const Statement* raw = stmt.get();
+  propagates.push_back(false
+    || dynamic_cast<const Return*>(raw)
+    || dynamic_cast<const IfElse*>(raw)
+    || dynamic_cast<const Compound*>(raw)
+    || dynamic_cast<const While*>(raw)
+    || dynamic_cast<const RangeFor*>(raw)
+    || dynamic_cast<const ForIn*>(raw)
+    || dynamic_cast<const Break*>(raw)
+    || dynamic_cast<const Continue*>(raw)
+  );
+  statements.push_back(std::move(stmt));
+}
+
+ObjectHolder Compound::Execute(Closure& closure) const {
+  for (size_t i = 0; i < statements.size(); ++i) {
+    Runtime::CountStep();
+    auto ret = statements[i]->Execute(closure);
+    if (propagates[i] && ret.Get()) {
       return ret;
     }
   }
   return ObjectHolder::None();
 }
 
-ObjectHolder Return::Execute(Closure& closure) {
-  return statement.get()->Execute(closure);
+std::unique_ptr<Return> Return::TailCall(std::unique_ptr<MethodCall> call) {
+  MethodCall* raw = call.get();
+  auto result = std::make_unique<Return>(std::move(call));
+  result->tail_call = raw;
+  return result;
+}
+
+namespace {
+// Results of break, continue and `return None`: they travel up through the
+// enclosing blocks like a returned value until the loop or the method call
+// recognizes them by address.
+class Signal : public Runtime::Object {
+public:
+  void Print(std::ostream&) override {}
+};
+
+Signal RETURNED_NONE;
+Signal BREAK_SIGNAL;
+Signal CONTINUE_SIGNAL;
 }
 
-ClassDefinition::ClassDefinition(ObjectHolder class_) : cls(class_), class_name(cls.TryAs<Runtime::Class>()->GetName()) {}
+bool Return::IsReturnedNone(const ObjectHolder& result) {
+  return result.Get() == &RETURNED_NONE;
+}
 
-ObjectHolder ClassDefinition::Execute(Runtime::Closure& closure) {
-  closure[class_name] = cls;
-  return closure[class_name];
+ObjectHolder Return::Execute(Closure& closure) const {
+  if (tail_call) {
+    return tail_call->ExecuteAsTailCall(closure);
+  }
+  ObjectHolder result = statement.get()->Execute(closure);
+  return result ? result : ObjectHolder::Share(RETURNED_NONE);
+}
+
+ClassDefinition::ClassDefinition(ObjectHolder class_)
+  : cls(class_), shared_class(*cls.TryAs<Runtime::Class>()), class_name(shared_class.GetName()) {}
+
+ObjectHolder ClassDefinition::Execute(Runtime::Closure& closure) const {
+  // The node owns the class; executions only refer to it, without touching
+  // its reference count
+  ObjectHolder& slot = closure[class_name];
+  slot = ObjectHolder::Share(shared_class);
+  return slot;
 }
 
 FieldAssignment::FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv)
@@ -192,7 +428,7 @@ FieldAssignment::FieldAssignment(VariableValue object, std::string field_name, s
 {
 }
 
-ObjectHolder FieldAssignment::Execute(Runtime::Closure& closure) {
+ObjectHolder FieldAssignment::Execute(Runtime::Closure& closure) const {
   Runtime::Closure& object_fields = object.Execute(closure).TryAs<Runtime::ClassInstance>()->Fields();
   ObjectHolder right = right_value.get()->Execute(closure);
   object_fields[field_name] = right;
@@ -209,7 +445,7 @@ IfElse::IfElse(
 {
 }
 
-ObjectHolder IfElse::Execute(Runtime::Closure& closure) {
+ObjectHolder IfElse::Execute(Runtime::Closure& closure) const {
   if (Runtime::IsTrue(condition->Execute(closure))) {
     return if_body.get()->Execute(closure);
   } else if (else_body) {
@@ -218,34 +454,192 @@ ObjectHolder IfElse::Execute(Runtime::Closure& closure) {
   return ObjectHolder::None();
 }
 
-ObjectHolder Or::Execute(Runtime::Closure& closure) {
-  return ObjectHolder::Own(
-    Runtime::Bool(Runtime::IsTrue(lhs->Execute(closure)) || Runtime::IsTrue(rhs->Execute(closure)))
-  );
+namespace {
+enum class LoopAction { Next, Break, Return };
+
+LoopAction ActionFor(const ObjectHolder& body_result) {
+  if (!body_result || body_result.Get() == &CONTINUE_SIGNAL) {
+    return LoopAction::Next;
+  }
+  return body_result.Get() == &BREAK_SIGNAL ? LoopAction::Break : LoopAction::Return;
 }
 
-ObjectHolder And::Execute(Runtime::Closure& closure) {
-  return ObjectHolder::Own(
-    Runtime::Bool(Runtime::IsTrue(lhs->Execute(closure)) && Runtime::IsTrue(rhs->Execute(closure)))
-  );
+int64_t ExpectInteger(const ObjectHolder& object, const char* what) {
+  if (KindOf(object) != Runtime::ObjectKind::Number) {
+    throw std::runtime_error(std::string(what) + " must be an integer");
+  }
+  return static_cast<const Runtime::Number&>(*object).GetValue();
 }
 
-ObjectHolder Not::Execute(Runtime::Closure& closure) {
-  return ObjectHolder::Own(
-    Runtime::Bool(!Runtime::IsTrue(argument->Execute(closure)))
-  );
+// Rebinds the loop variable, reusing its Number when no one else holds it
+void StoreCounter(ObjectHolder& slot, int64_t value) {
+  if (slot.IsUnique() && KindOf(slot) == Runtime::ObjectKind::Number) {
+    static_cast<Runtime::Number&>(*slot).value = value;
+  } else {
+    slot = ObjectHolder::Own(Runtime::Number(value));
+  }
+}
+}
+
+ObjectHolder Break::Execute(Closure&) const {
+  return ObjectHolder::Share(BREAK_SIGNAL);
+}
+
+ObjectHolder Continue::Execute(Closure&) const {
+  return ObjectHolder::Share(CONTINUE_SIGNAL);
+}
+
+While::While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body)
+  : condition(std::move(condition)), body(std::move(body)) {}
+
+ObjectHolder While::Execute(Closure& closure) const {
+  while (Runtime::IsTrue(condition->Execute(closure))) {
+    ObjectHolder result = body->Execute(closure);
+    switch (ActionFor(result)) {
+      case LoopAction::Next:
+        continue;
+      case LoopAction::Break:
+        return ObjectHolder::None();
+      case LoopAction::Return:
+        return result;
+    }
+  }
+  return ObjectHolder::None();
+}
+
+Range::Range(std::unique_ptr<Statement> start, std::unique_ptr<Statement> stop, std::unique_ptr<Statement> step)
+  : start(std::move(start)), stop(std::move(stop)), step(std::move(step)) {}
+
+Range::Bounds Range::Evaluate(Closure& closure) const {
+  Bounds bounds{0, 0, 1};
+  if (start) {
+    bounds.start = ExpectInteger(start->Execute(closure), "range() start");
+  }
+  bounds.stop = ExpectInteger(stop->Execute(closure), "range() stop");
+  if (step) {
+    bounds.step = ExpectInteger(step->Execute(closure), "range() step");
+    if (bounds.step == 0) {
+      throw std::runtime_error("range() step must not be zero");
+    }
+  }
+  return bounds;
+}
+
+ObjectHolder Range::Execute(Closure& closure) const {
+  const Bounds bounds = Evaluate(closure);
+  std::vector<ObjectHolder> items;
+  for (int64_t i = bounds.start; bounds.step > 0 ? i < bounds.stop : i > bounds.stop;) {
+    items.push_back(ObjectHolder::Own(Runtime::Number(i)));
+    if (__builtin_add_overflow(i, bounds.step, &i)) {
+      break;
+    }
+  }
+  return ObjectHolder::Own(Runtime::List(std::move(items)));
+}
+
+RangeFor::RangeFor(std::string variable, std::unique_ptr<Range> range, std::unique_ptr<Statement> body)
+  : variable(std::move(variable)), range(std::move(range)), body(std::move(body)) {}
+
+ObjectHolder RangeFor::Execute(Closure& closure) const {
+  const Range::Bounds bounds = range->Evaluate(closure);
+  // References into the closure survive rehashing, and variables are never erased
+  ObjectHolder& slot = closure[variable];
+  for (int64_t i = bounds.start; bounds.step > 0 ? i < bounds.stop : i > bounds.stop;) {
+    StoreCounter(slot, i);
+    ObjectHolder result = body->Execute(closure);
+    switch (ActionFor(result)) {
+      case LoopAction::Next:
+        break;
+      case LoopAction::Break:
+        return ObjectHolder::None();
+      case LoopAction::Return:
+        return result;
+    }
+    if (__builtin_add_overflow(i, bounds.step, &i)) {
+      break;
+    }
+  }
+  return ObjectHolder::None();
+}
+
+ForIn::ForIn(std::string variable, std::unique_ptr<Statement> iterable, std::unique_ptr<Statement> body)
+  : variable(std::move(variable)), iterable(std::move(iterable)), body(std::move(body)) {}
+
+ObjectHolder ForIn::Execute(Closure& closure) const {
+  ObjectHolder sequence = iterable->Execute(closure);
+  ObjectHolder& slot = closure[variable];
+
+  auto run_body = [&](ObjectHolder item, ObjectHolder& result) {
+    slot = std::move(item);
+    result = body->Execute(closure);
+    return ActionFor(result);
+  };
+  ObjectHolder result;
+
+  switch (KindOf(sequence)) {
+    case Runtime::ObjectKind::List: {
+      // The body may change the list; the length is re-read every time
+      const auto& items = static_cast<const Runtime::List&>(*sequence).Items();
+      for (size_t i = 0; i < items.size(); ++i) {
+        LoopAction action = run_body(items[i], result);
+        if (action != LoopAction::Next) {
+          return action == LoopAction::Return ? result : ObjectHolder::None();
+        }
+      }
+      break;
+    }
+    case Runtime::ObjectKind::Dict: {
+      std::vector<ObjectHolder> keys;
+      keys.reserve(sequence.TryAs<Runtime::Dict>()->Table().Size());
+      sequence.TryAs<Runtime::Dict>()->Table().ForEach([&keys](const Runtime::HashTable::Entry& entry) {
+        keys.push_back(entry.key);
+      });
+      for (ObjectHolder& key : keys) {
+        LoopAction action = run_body(std::move(key), result);
+        if (action != LoopAction::Next) {
+          return action == LoopAction::Return ? result : ObjectHolder::None();
+        }
+      }
+      break;
+    }
+    case Runtime::ObjectKind::String: {
+      const std::string& text = sequence.TryAs<Runtime::String>()->GetValue();
+      for (char c : text) {
+        LoopAction action = run_body(Runtime::MakeString(std::string(1, c)), result);
+        if (action != LoopAction::Next) {
+          return action == LoopAction::Return ? result : ObjectHolder::None();
+        }
+      }
+      break;
+    }
+    default:
+      throw std::runtime_error("object is not iterable");
+  }
+  return ObjectHolder::None();
+}
+
+ObjectHolder Or::Execute(Runtime::Closure& closure) const {
+  return BoolResult(Runtime::IsTrue(lhs->Execute(closure)) || Runtime::IsTrue(rhs->Execute(closure)));
+}
+
+ObjectHolder And::Execute(Runtime::Closure& closure) const {
+  return BoolResult(Runtime::IsTrue(lhs->Execute(closure)) && Runtime::IsTrue(rhs->Execute(closure)));
+}
+
+ObjectHolder Not::Execute(Runtime::Closure& closure) const {
+  return BoolResult(!Runtime::IsTrue(argument->Execute(closure)));
 }
 
 
 Comparison::Comparison(Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs
 ) : left(std::move(lhs)), right(std::move(rhs)), comparator(cmp) {}
 
-ObjectHolder Comparison::Execute(Runtime::Closure& closure) {
+ObjectHolder Comparison::Execute(Runtime::Closure& closure) const {
   ObjectHolder left_value = left.get()->Execute(closure);
   ObjectHolder right_value = right.get()->Execute(closure);
-  bool res = comparator(left_value, right_value);
+  bool res = Runtime::Compare(comparator, left_value, right_value);
   
-  return ObjectHolder::Own(Runtime::Bool(res));
+  return BoolResult(res);
 }
 
 NewInstance::NewInstance(const Runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args
@@ -254,8 +648,10 @@ NewInstance::NewInstance(const Runtime::Class& class_, std::vector<std::unique_p
 NewInstance::NewInstance(const Runtime::Class& class_) : NewInstance(class_, {}) {
 }
 
-ObjectHolder NewInstance::Execute(Runtime::Closure& closure) {
-  Runtime::ClassInstance new_instance(_class_);
+ObjectHolder NewInstance::Execute(Runtime::Closure& closure) const {
+  // Owned before __init__ runs, so a `self` it stores refers to the final object
+  ObjectHolder holder = ObjectHolder::Own(Runtime::ClassInstance(_class_));
+  auto& new_instance = static_cast<Runtime::ClassInstance&>(*holder);
   if (new_instance.HasMethod("__init__", args.size())) {
     std::vector<ObjectHolder> actual_args;
     for (const auto& statement : args) {
@@ -263,7 +659,6 @@ ObjectHolder NewInstance::Execute(Runtime::Closure& closure) {
     }
     new_instance.Call("__init__", std::move(actual_args));
   }
-  ObjectHolder holder = ObjectHolder::Own(std::move(new_instance));
   return holder;
 }
 
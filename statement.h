@@ -2,6 +2,9 @@
 
 #include "object_holder.h"
 #include "object.h"
+#include "comparators.h"
+#include "output_sink.h"
+#include "builtins.h"
 
 #include <unordered_map>
 #include <string>
@@ -16,22 +19,49 @@ namespace Ast {
 
 struct Statement {
   virtual ~Statement() = default;
-  virtual ObjectHolder Execute(Runtime::Closure& closure) = 0;
+  virtual ObjectHolder Execute(Runtime::Closure& closure) const = 0;
 };
 
+// Nodes are immutable once parsed, so one tree can be executed by many
+// threads at once; Execute is const and every node keeps its state local.
+
 template <typename T>
 struct ValueStatement : Statement {
-  T value;
+  // Handed out through Share: such holders never count as unique, so the
+  // in-place updates of temporaries never touch a constant
+  mutable T value;
 
   explicit ValueStatement(T v) : value(std::move(v)) {
   }
 
-  ObjectHolder Execute(Runtime::Closure&) override {
+  ObjectHolder Execute(Runtime::Closure&) const override {
+    return ObjectHolder::Share(value);
+  }
+};
+
+// String literals are interned, so equal literals share one immutable object.
+// The program they belong to holds them in the pool for as long as it lives.
+template <>
+struct ValueStatement<Runtime::String> : Statement {
+  Runtime::String& value;
+
+  explicit ValueStatement(Runtime::String v)
+    : value(Runtime::StringPool::Instance().Acquire(v.GetValue())) {
+  }
+  ValueStatement(const ValueStatement&) = delete;
+  ValueStatement& operator=(const ValueStatement&) = delete;
+  ~ValueStatement() override {
+    Runtime::StringPool::Instance().Release(value);
+  }
+
+  ObjectHolder Execute(Runtime::Closure&) const override {
     return ObjectHolder::Share(value);
   }
 };
 
 using NumericConst = ValueStatement<Runtime::Number>;
+using BigNumericConst = ValueStatement<Runtime::BigNumber>;
+using FloatConst = ValueStatement<Runtime::Float>;
 using StringConst = ValueStatement<Runtime::String>;
 using BoolConst = ValueStatement<Runtime::Bool>;
 
@@ -40,15 +70,21 @@ struct VariableValue : Statement {
 
   explicit VariableValue(std::string var_name);
   explicit VariableValue(std::vector<std::string> dotted_ids);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
+class ArithmeticOperation;
+
 struct Assignment : Statement {
   std::string var_name;
   std::unique_ptr<Statement> right_value;
 
   Assignment(std::string var, std::unique_ptr<Statement> rv);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+
+private:
+  // right_value, if it is arithmetic
+  const ArithmeticOperation* arithmetic = nullptr;
 };
 
 struct FieldAssignment : Statement {
@@ -57,11 +93,11 @@ struct FieldAssignment : Statement {
   std::unique_ptr<Statement> right_value;
 
   FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 struct None : Statement {
-  ObjectHolder Execute(Runtime::Closure&) override {
+  ObjectHolder Execute(Runtime::Closure&) const override {
     return ObjectHolder::None();
   }
 };
@@ -73,13 +109,19 @@ public:
 
   static std::unique_ptr<Print> Variable(std::string name);
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 
+  // The output is per thread, so interpreters on different threads never share it
   static void SetOutputStream(std::ostream& output_stream);
+  static void SetOutputSink(Runtime::OutputSink& sink);
+  static Runtime::OutputSink& GetOutputSink();
+  // The line being assembled; it belongs to the output, so whoever rebinds
+  // the output mid-line (a suspended task) sets it aside as well
+  static std::string& PendingLine();
 
 private:
   std::vector<std::unique_ptr<Statement>> args;
-  static std::ostream* output;
+  static thread_local Runtime::OutputSink* output;
 };
 
 struct MethodCall : Statement {
@@ -93,7 +135,21 @@ struct MethodCall : Statement {
     std::vector<std::unique_ptr<Statement>> args
   );
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+  // Evaluates the target and the arguments, leaving the call itself to the caller
+  ObjectHolder ExecuteAsTailCall(Runtime::Closure& closure) const;
+
+private:
+  std::vector<ObjectHolder> EvaluateArgs(Runtime::Closure& closure) const;
+};
+
+// Call of a registered native function, resolved when the program is parsed
+struct BuiltinCall : Statement {
+  const Runtime::Builtin& builtin;
+  std::vector<std::unique_ptr<Statement>> args;
+
+  BuiltinCall(const Runtime::Builtin& builtin, std::vector<std::unique_ptr<Statement>> args);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 struct NewInstance : Statement {
@@ -102,7 +158,56 @@ struct NewInstance : Statement {
 
   NewInstance(const Runtime::Class& class_);
   NewInstance(const Runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+struct ListLiteral : Statement {
+  std::vector<std::unique_ptr<Statement>> items;
+
+  explicit ListLiteral(std::vector<std::unique_ptr<Statement>> items);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+struct DictLiteral : Statement {
+  std::vector<std::pair<std::unique_ptr<Statement>, std::unique_ptr<Statement>>> items;
+
+  explicit DictLiteral(std::vector<std::pair<std::unique_ptr<Statement>, std::unique_ptr<Statement>>> items);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+struct Index : Statement {
+  std::unique_ptr<Statement> object;
+  std::unique_ptr<Statement> index;
+
+  Index(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+// object[begin:end], either bound may be omitted
+struct Slice : Statement {
+  std::unique_ptr<Statement> object;
+  std::unique_ptr<Statement> begin, end;
+
+  Slice(std::unique_ptr<Statement> object, std::unique_ptr<Statement> begin, std::unique_ptr<Statement> end);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+struct IndexAssignment : Statement {
+  std::unique_ptr<Statement> object;
+  std::unique_ptr<Statement> index;
+  std::unique_ptr<Statement> right_value;
+
+  IndexAssignment(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index, std::unique_ptr<Statement> rv);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+// del object[index]
+struct Delete : Statement {
+  std::unique_ptr<Statement> object;
+  std::unique_ptr<Statement> index;
+
+  Delete(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index);
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class UnaryOperation : public Statement {
@@ -117,7 +222,7 @@ protected:
 class Stringify : public UnaryOperation {
 public:
   using UnaryOperation::UnaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class BinaryOperation : public Statement {
@@ -132,63 +237,85 @@ protected:
   std::unique_ptr<Statement> lhs, rhs;
 };
 
-class Add : public BinaryOperation {
+// Add, Sub, Mult and Div. An Assignment passes the variable it assigns as
+// the destination, whose number may then be reused for the result (see
+// Runtime::Arithmetic).
+class ArithmeticOperation : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override { return Execute(closure, nullptr); }
+  virtual ObjectHolder Execute(Runtime::Closure& closure, const ObjectHolder* destination) const = 0;
 };
 
-class Sub : public BinaryOperation {
+class Add : public ArithmeticOperation {
 public:
-  using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  using ArithmeticOperation::ArithmeticOperation;
+  using ArithmeticOperation::Execute;
+  ObjectHolder Execute(Runtime::Closure& closure, const ObjectHolder* destination) const override;
 };
 
-class Mult : public BinaryOperation {
+class Sub : public ArithmeticOperation {
 public:
-  using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  using ArithmeticOperation::ArithmeticOperation;
+  using ArithmeticOperation::Execute;
+  ObjectHolder Execute(Runtime::Closure& closure, const ObjectHolder* destination) const override;
+};
+
+class Mult : public ArithmeticOperation {
+public:
+  using ArithmeticOperation::ArithmeticOperation;
+  using ArithmeticOperation::Execute;
+  ObjectHolder Execute(Runtime::Closure& closure, const ObjectHolder* destination) const override;
+};
+
+class Div : public ArithmeticOperation {
+public:
+  using ArithmeticOperation::ArithmeticOperation;
+  using ArithmeticOperation::Execute;
+  ObjectHolder Execute(Runtime::Closure& closure, const ObjectHolder* destination) const override;
 };
 
-class Div : public BinaryOperation {
+// item in container
+class Membership : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class Or : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class And : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class Not : public UnaryOperation {
 public:
   using UnaryOperation::UnaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class Compound : public Statement {
 public:
   template <typename ...Args>
   explicit Compound(Args&& ...args) {
-    (statements.push_back(std::forward<Args>(args)), ...);
+    (AddStatement(std::forward<Args>(args)), ...);
   }
 
-  void AddStatement(std::unique_ptr<Statement> stmt) {
-    statements.push_back(std::move(stmt));
-  }
+  void AddStatement(std::unique_ptr<Statement> stmt);
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 
 private:
   std::vector<std::unique_ptr<Statement>> statements;
+  // Whether a non-empty result of the statement ends the block (return,
+  // break, continue or a nested block doing so); computed when it is added
+  std::vector<bool> propagates;
 };
 
 class Return : public Statement {
@@ -198,20 +325,31 @@ public:
   {
   }
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  // `return obj.method(...)` in a method body: yields a Runtime::TailCall
+  // that the calling ClassInstance::Call performs instead of recursing
+  static std::unique_ptr<Return> TailCall(std::unique_ptr<MethodCall> call);
+
+  // Returning None yields a marker instead, so that blocks and loops stop
+  // and hand it up like any other returned value; ClassInstance::Call turns
+  // it back into None
+  static bool IsReturnedNone(const ObjectHolder& result);
+
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 
 private:
   std::unique_ptr<Statement> statement;
+  MethodCall* tail_call = nullptr;
 };
 
 class ClassDefinition : public Statement {
 public:
   explicit ClassDefinition(ObjectHolder cls);
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 
 private:
   ObjectHolder cls;
+  Runtime::Class& shared_class;
   const std::string& class_name;
 };
 
@@ -223,16 +361,73 @@ public:
     std::unique_ptr<Statement> else_body
   );
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 
 private:
   std::unique_ptr<Statement> condition, if_body, else_body;
-  bool Returned = false;
+};
+
+class While : public Statement {
+public:
+  While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body);
+
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+
+private:
+  std::unique_ptr<Statement> condition, body;
+};
+
+// range(stop), range(start, stop) or range(start, stop, step); as an
+// expression it evaluates to a list
+struct Range : Statement {
+  struct Bounds {
+    int64_t start, stop, step;
+  };
+
+  std::unique_ptr<Statement> start, stop, step;
+
+  Range(std::unique_ptr<Statement> start, std::unique_ptr<Statement> stop, std::unique_ptr<Statement> step);
+  Bounds Evaluate(Runtime::Closure& closure) const;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+// for variable in range(...): the counter is kept as a native integer and
+// the variable's Number is updated in place while nothing else refers to it
+class RangeFor : public Statement {
+public:
+  RangeFor(std::string variable, std::unique_ptr<Range> range, std::unique_ptr<Statement> body);
+
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+
+private:
+  std::string variable;
+  std::unique_ptr<Range> range;
+  std::unique_ptr<Statement> body;
+};
+
+// for variable in iterable: lists, dict keys and string characters
+class ForIn : public Statement {
+public:
+  ForIn(std::string variable, std::unique_ptr<Statement> iterable, std::unique_ptr<Statement> body);
+
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+
+private:
+  std::string variable;
+  std::unique_ptr<Statement> iterable, body;
+};
+
+struct Break : Statement {
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
+};
+
+struct Continue : Statement {
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 };
 
 class Comparison : public Statement {
 public:
-  using Comparator = std::function<bool(const ObjectHolder&, const ObjectHolder&)>;
+  using Comparator = Runtime::CompareOp;
 
   Comparison(
     Comparator cmp,
@@ -240,7 +435,7 @@ public:
     std::unique_ptr<Statement> rhs
   );
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder Execute(Runtime::Closure& closure) const override;
 
 private:
   Comparator comparator;
@@ -197,6 +197,15 @@ void TestStringify() {
   }
 }
 
+void TestStringifyLiterals() {
+  Closure empty;
+
+  ASSERT_OBJECT_VALUE_EQUAL(Stringify(make_unique<NumericConst>(-2147483647 - 1)).Execute(empty), "-2147483648");
+  ASSERT_OBJECT_VALUE_EQUAL(Stringify(make_unique<BoolConst>(Runtime::Bool(true))).Execute(empty), "True");
+  ASSERT_OBJECT_VALUE_EQUAL(Stringify(make_unique<BoolConst>(Runtime::Bool(false))).Execute(empty), "False");
+  ASSERT_OBJECT_VALUE_EQUAL(Stringify(make_unique<None>()).Execute(empty), "None");
+}
+
 void TestNumbersAddition() {
   Add sum(
     make_unique<NumericConst>(23),
@@ -291,6 +300,7 @@ void RunUnitTests(TestRunner& tr) {
   RUN_TEST(tr, Ast::TestPrintVariable);
   RUN_TEST(tr, Ast::TestPrintMultipleStatements);
   RUN_TEST(tr, Ast::TestStringify);
+  RUN_TEST(tr, Ast::TestStringifyLiterals);
   RUN_TEST(tr, Ast::TestNumbersAddition);
   RUN_TEST(tr, Ast::TestStringsAddition);
   RUN_TEST(tr, Ast::TestBadAddition);
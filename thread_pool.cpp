@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+// Index of the worker running on this thread, for the pool it belongs to
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+  thread_count = std::max<size_t>(thread_count, 1);
+  for (size_t i = 0; i < thread_count; ++i) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < thread_count; ++i) {
+    workers.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  work_available.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  size_t target;
+  {
+    std::lock_guard lock(mutex);
+    if (current_pool == this) {
+      target = current_worker;
+    } else {
+      target = next_queue;
+      next_queue = (next_queue + 1) % queues.size();
+    }
+    ++queued;
+    ++unfinished;
+  }
+  {
+    std::lock_guard lock(queues[target]->mutex);
+    queues[target]->tasks.push_back(std::move(task));
+  }
+  work_available.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock lock(mutex);
+  all_done.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool ThreadPool::TryTake(size_t worker, std::function<void()>& task) {
+  {
+    Queue& own = *queues[worker];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t offset = 1; offset < queues.size(); ++offset) {
+    Queue& victim = *queues[(worker + offset) % queues.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+  current_pool = this;
+  current_worker = worker;
+  while (true) {
+    {
+      std::unique_lock lock(mutex);
+      work_available.wait(lock, [this] { return stopping || queued > 0; });
+      if (queued == 0) {
+        return;
+      }
+      // Claimed under the lock, so the task is certainly in some deque
+      --queued;
+    }
+    std::function<void()> task;
+    while (!TryTake(worker, task)) {
+      std::this_thread::yield();
+    }
+    task();
+    task = nullptr;
+    std::lock_guard lock(mutex);
+    if (--unfinished == 0) {
+      all_done.notify_all();
+    }
+  }
+}
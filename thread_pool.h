@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TestRunner;
+
+// Fixed set of workers, each with its own task deque. A worker takes its
+// newest task first and, when its deque runs dry, steals the oldest task of
+// another worker, so uneven tasks still keep every thread busy. Tasks
+// submitted by a worker go to that worker's own deque.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  // Tasks must not throw
+  void Submit(std::function<void()> task);
+  // Blocks until every submitted task has finished
+  void Wait();
+
+  size_t ThreadCount() const { return workers.size(); }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool TryTake(size_t worker, std::function<void()>& task);
+  void WorkerLoop(size_t worker);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable work_available;
+  std::condition_variable all_done;
+  size_t queued = 0;      // submitted and not yet taken
+  size_t unfinished = 0;  // submitted and not yet finished
+  size_t next_queue = 0;
+  bool stopping = false;
+};
+
+void RunThreadPoolTests(TestRunner& tr);
@@ -0,0 +1,57 @@
+#include "thread_pool.h"
+
+#include "test_runner.h"
+
+#include <atomic>
+#include <set>
+
+using namespace std;
+
+void TestThreadPoolRunsAllTasks() {
+  ThreadPool pool(4);
+  atomic<int> sum = 0;
+  for (int i = 1; i <= 1000; ++i) {
+    pool.Submit([&sum, i] { sum += i; });
+  }
+  pool.Wait();
+  ASSERT_EQUAL(sum.load(), 500500);
+
+  pool.Submit([&sum] { sum = 0; });
+  pool.Wait();
+  ASSERT_EQUAL(sum.load(), 0);
+}
+
+void TestThreadPoolNestedTasks() {
+  ThreadPool pool(3);
+  atomic<int> leaves = 0;
+  // Every task spawns its children into its own deque; idle workers steal them
+  function<void(int)> spawn = [&](int depth) {
+    if (depth == 0) {
+      ++leaves;
+      return;
+    }
+    for (int i = 0; i < 4; ++i) {
+      pool.Submit([&spawn, depth] { spawn(depth - 1); });
+    }
+  };
+  pool.Submit([&spawn] { spawn(5); });
+  pool.Wait();
+  ASSERT_EQUAL(leaves.load(), 1024);
+}
+
+void TestThreadPoolSingleThread() {
+  ThreadPool pool(0);
+  ASSERT_EQUAL(pool.ThreadCount(), 1u);
+  int counter = 0;
+  for (int i = 0; i < 10; ++i) {
+    pool.Submit([&counter] { ++counter; });
+  }
+  pool.Wait();
+  ASSERT_EQUAL(counter, 10);
+}
+
+void RunThreadPoolTests(TestRunner& tr) {
+  RUN_TEST(tr, TestThreadPoolRunsAllTasks);
+  RUN_TEST(tr, TestThreadPoolNestedTasks);
+  RUN_TEST(tr, TestThreadPoolSingleThread);
+}